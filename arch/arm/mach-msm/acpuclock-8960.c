@@ -1361,6 +1361,38 @@ static unsigned int calculate_vdd_core(struct acpu_level *tgt)
 	return tgt->vdd_core + (enable_boost ? boost_uv : 0);
 }
 
+static struct acpu_level *find_acpu_level(unsigned long rate)
+{
+	struct acpu_level *tgt;
+
+	for (tgt = acpu_freq_tbl; tgt->speed.khz != 0; tgt++)
+		if (tgt->speed.khz == rate)
+			return tgt;
+
+	return NULL;
+}
+
+/* Raise voltages for an upcoming switch to rate, leaving clocks alone. */
+static int acpuclk_8960_prepare_rate(int cpu, unsigned long rate)
+{
+	struct acpu_level *tgt;
+	int rc;
+
+	if (cpu > num_possible_cpus())
+		return -EINVAL;
+
+	tgt = find_acpu_level(rate);
+	if (!tgt)
+		return -EINVAL;
+
+	mutex_lock(&driver_lock);
+	rc = increase_vdd(cpu, calculate_vdd_core(tgt), calculate_vdd_mem(tgt),
+			  calculate_vdd_dig(tgt), SETRATE_CPUFREQ);
+	mutex_unlock(&driver_lock);
+
+	return rc;
+}
+
 /* Set the CPU's clock rate and adjust the L2 rate, if appropriate. */
 static int acpuclk_8960_set_rate(int cpu, unsigned long rate,
 				 enum setrate_reason reason)
@@ -1386,21 +1418,27 @@ static int acpuclk_8960_set_rate(int cpu, unsigned long rate,
 
 	strt_acpu_s = scalable[cpu].current_speed;
 
-	/* Return early if rate didn't change. */
-	if (rate == strt_acpu_s->khz)
+	/*
+	 * Return early if rate didn't change, but drop any voltage that
+	 * acpuclk_8960_prepare_rate() raised for a switch that was then
+	 * called off.
+	 */
+	if (rate == strt_acpu_s->khz) {
+		tgt = find_acpu_level(rate);
+		if (tgt && reason == SETRATE_CPUFREQ)
+			decrease_vdd(cpu, calculate_vdd_core(tgt),
+				     calculate_vdd_mem(tgt),
+				     calculate_vdd_dig(tgt), reason);
 		goto out;
+	}
 
 	/* Find target frequency. */
-	for (tgt = acpu_freq_tbl; tgt->speed.khz != 0; tgt++) {
-		if (tgt->speed.khz == rate) {
-			tgt_acpu_s = &tgt->speed;
-			break;
-		}
-	}
-	if (tgt->speed.khz == 0) {
+	tgt = find_acpu_level(rate);
+	if (!tgt) {
 		rc = -EINVAL;
 		goto out;
 	}
+	tgt_acpu_s = &tgt->speed;
 
 	/* Calculate voltage requirements for the current CPU. */
 	vdd_mem  = calculate_vdd_mem(tgt);
@@ -1832,6 +1870,7 @@ static void __init select_freq_plan(void)
 
 static struct acpuclk_data acpuclk_8960_data = {
 	.set_rate = acpuclk_8960_set_rate,
+	.prepare_rate = acpuclk_8960_prepare_rate,
 	.get_rate = acpuclk_8960_get_rate,
 	.power_collapse_khz = STBY_KHZ,
 	.wait_for_irq_khz = STBY_KHZ,
@@ -31,6 +31,14 @@ int acpuclk_set_rate(int cpu, unsigned long rate, enum setrate_reason reason)
 	return acpuclk_data->set_rate(cpu, rate, reason);
 }
 
+int acpuclk_prepare_rate(int cpu, unsigned long rate)
+{
+	if (!acpuclk_data->prepare_rate)
+		return 0;
+
+	return acpuclk_data->prepare_rate(cpu, rate);
+}
+
 uint32_t acpuclk_get_switch_time(void)
 {
 	return acpuclk_data->switch_time_us;
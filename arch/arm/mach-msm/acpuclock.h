@@ -45,6 +45,7 @@ struct acpuclk_soc_data {
 struct acpuclk_data {
 	unsigned long (*get_rate)(int cpu);
 	int (*set_rate)(int cpu, unsigned long rate, enum setrate_reason);
+	int (*prepare_rate)(int cpu, unsigned long rate);
 	uint32_t switch_time_us;
 	unsigned long power_collapse_khz;
 	unsigned long wait_for_irq_khz;
@@ -66,6 +67,20 @@ unsigned long acpuclk_get_rate(int cpu);
  */
 int acpuclk_set_rate(int cpu, unsigned long rate, enum setrate_reason);
 
+/**
+ * acpuclk_prepare_rate() - Raise a CPU's voltages ahead of a rate switch
+ * @cpu: CPU that is about to switch
+ * @rate: Rate in KHz it is about to switch to
+ *
+ * Performs the voltage increases a later acpuclk_set_rate(@cpu, @rate,
+ * SETRATE_CPUFREQ) would need, so that the switch itself only has to
+ * change clocks. Must be called on @cpu. A subsequent acpuclk_set_rate()
+ * for any rate, including the current one, drops excess voltage again.
+ *
+ * Returns 0 for success.
+ */
+int acpuclk_prepare_rate(int cpu, unsigned long rate);
+
 /**
  * acpuclk_get_switch_time() - Query estimated time in us for a CPU rate switch
  */
@@ -36,16 +36,27 @@
 #endif
 
 #ifdef CONFIG_SMP
+/*
+ * Per-cpu frequency transition queue. In async mode a request only
+ * records its target and queues the work, so the governor never waits for
+ * the regulator and RPM round trips. Requests arriving before the work
+ * has run are merged: the work always switches to the latest target.
+ */
 struct cpufreq_work_struct {
 	struct work_struct work;
 	struct cpufreq_policy *policy;
 	struct completion complete;
+	spinlock_t lock;
 	int frequency;
+	unsigned int seq;	/* cpufreq_request_seq() of frequency */
 	int status;
 };
 
 static DEFINE_PER_CPU(struct cpufreq_work_struct, cpufreq_work);
 static struct workqueue_struct *msm_cpufreq_wq;
+
+static int async_transitions = 1;
+module_param_named(async, async_transitions, int, S_IRUGO | S_IWUSR);
 #endif
 
 struct cpufreq_suspend_t {
@@ -67,7 +78,8 @@ static DEFINE_PER_CPU(struct cpu_freq, cpu_freq_info);
 
 /* mfreq is reverted, this is a redundant variable*/
 static int override_cpu = 0;
-static int set_cpu_freq(struct cpufreq_policy *policy, unsigned int new_freq)
+static int set_cpu_freq(struct cpufreq_policy *policy, unsigned int new_freq,
+			unsigned int seq)
 {
 	int ret = 0;
 #ifdef CONFIG_PERFLOCK
@@ -114,6 +126,7 @@ static int set_cpu_freq(struct cpufreq_policy *policy, unsigned int new_freq)
 		freqs.new = new_freq;
 #endif
 	freqs.cpu = policy->cpu;
+	freqs.seq = seq;
 	cpufreq_notify_transition(&freqs, CPUFREQ_PRECHANGE);
 	ret = acpuclk_set_rate(policy->cpu, freqs.new, SETRATE_CPUFREQ);
 	if (!ret)
@@ -123,14 +136,74 @@ static int set_cpu_freq(struct cpufreq_policy *policy, unsigned int new_freq)
 }
 
 #ifdef CONFIG_SMP
+static int cpu_work_frequency(struct cpufreq_work_struct *cpu_work,
+			      struct cpufreq_policy **policy, unsigned int *seq)
+{
+	unsigned long flags;
+	int frequency;
+
+	spin_lock_irqsave(&cpu_work->lock, flags);
+	*policy = cpu_work->policy;
+	frequency = cpu_work->frequency;
+	*seq = cpu_work->seq;
+	spin_unlock_irqrestore(&cpu_work->lock, flags);
+
+	return frequency;
+}
+
 static void set_cpu_work(struct work_struct *work)
 {
 	struct cpufreq_work_struct *cpu_work =
 		container_of(work, struct cpufreq_work_struct, work);
+	struct cpufreq_policy *policy;
+	unsigned int seq;
+	int frequency;
 
-	cpu_work->status = set_cpu_freq(cpu_work->policy, cpu_work->frequency);
+	frequency = cpu_work_frequency(cpu_work, &policy, &seq);
+	if (smp_processor_id() != policy->cpu) {
+		cpu_work->status = -EAGAIN;
+		goto out;
+	}
+
+	/*
+	 * Ramp the voltages first; the round trip leaves time for further
+	 * requests to come in, and the switch below then takes the newest.
+	 */
+	if (frequency > policy->cur)
+		acpuclk_prepare_rate(policy->cpu, frequency);
+
+	frequency = cpu_work_frequency(cpu_work, &policy, &seq);
+	if (frequency == policy->cur) {
+		/* drops any voltage raised above for nothing */
+		cpu_work->status = acpuclk_set_rate(policy->cpu, frequency,
+						    SETRATE_CPUFREQ);
+		goto out;
+	}
+
+	cpu_work->status = set_cpu_freq(policy, frequency, seq);
+out:
+	/*
+	 * No-op if the transition's POSTCHANGE already accounted for the
+	 * request, or if a newer one was queued after we read ours.
+	 */
+	cpufreq_request_done(policy->cpu, seq);
 	complete(&cpu_work->complete);
 }
+
+/**
+ * msm_cpufreq_sync() - wait for queued frequency transitions to finish
+ * @cpu: cpu whose transition queue to drain
+ */
+void msm_cpufreq_sync(uint32_t cpu)
+{
+	flush_work(&per_cpu(cpufreq_work, cpu).work);
+}
+EXPORT_SYMBOL(msm_cpufreq_sync);
+#else
+void msm_cpufreq_sync(uint32_t cpu)
+{
+}
+EXPORT_SYMBOL(msm_cpufreq_sync);
 #endif
 
 static int msm_cpufreq_target(struct cpufreq_policy *policy,
@@ -178,25 +251,47 @@ static int msm_cpufreq_target(struct cpufreq_policy *policy,
 
 #ifdef CONFIG_SMP
 	cpu_work = &per_cpu(cpufreq_work, policy->cpu);
-	cpu_work->policy = policy;
-	cpu_work->frequency = table[index].frequency;
-	cpu_work->status = -ENODEV;
 
 	cpumask_clear(mask);
 	cpumask_set_cpu(policy->cpu, mask);
 	if (cpumask_equal(mask, &current->cpus_allowed)) {
-		ret = set_cpu_freq(cpu_work->policy, cpu_work->frequency);
+		unsigned int seq = cpufreq_request_seq(policy->cpu);
+
+		flush_work(&cpu_work->work);
+		ret = set_cpu_freq(policy, table[index].frequency, seq);
+		cpufreq_request_done(policy->cpu, seq);
 		goto done;
-	} else {
-		cancel_work_sync(&cpu_work->work);
-		INIT_COMPLETION(cpu_work->complete);
+	}
+
+	if (async_transitions) {
+		unsigned long flags;
+
+		spin_lock_irqsave(&cpu_work->lock, flags);
+		cpu_work->policy = policy;
+		cpu_work->frequency = table[index].frequency;
+		cpu_work->seq = cpufreq_request_seq(policy->cpu);
+		spin_unlock_irqrestore(&cpu_work->lock, flags);
+
 		queue_work_on(policy->cpu, msm_cpufreq_wq, &cpu_work->work);
-		wait_for_completion(&cpu_work->complete);
+		ret = 0;
+		goto done;
 	}
 
+	flush_work(&cpu_work->work);
+	spin_lock_irq(&cpu_work->lock);
+	cpu_work->policy = policy;
+	cpu_work->frequency = table[index].frequency;
+	cpu_work->seq = cpufreq_request_seq(policy->cpu);
+	spin_unlock_irq(&cpu_work->lock);
+	cpu_work->status = -ENODEV;
+	INIT_COMPLETION(cpu_work->complete);
+	queue_work_on(policy->cpu, msm_cpufreq_wq, &cpu_work->work);
+	wait_for_completion(&cpu_work->complete);
+
 	ret = cpu_work->status;
 #else
-	ret = set_cpu_freq(policy, table[index].frequency);
+	ret = set_cpu_freq(policy, table[index].frequency,
+			   cpufreq_request_seq(policy->cpu));
 #endif
 
 done:
@@ -341,6 +436,7 @@ static int __cpuinit msm_cpufreq_init(struct cpufreq_policy *policy)
 	cpu_work = &per_cpu(cpufreq_work, policy->cpu);
 	INIT_WORK(&cpu_work->work, set_cpu_work);
 	init_completion(&cpu_work->complete);
+	spin_lock_init(&cpu_work->lock);
 #endif
 
         policy->min = 245760;
@@ -356,6 +452,7 @@ static int msm_cpufreq_suspend(void)
 		mutex_lock(&per_cpu(cpufreq_suspend, cpu).suspend_mutex);
 		per_cpu(cpufreq_suspend, cpu).device_suspended = 1;
 		mutex_unlock(&per_cpu(cpufreq_suspend, cpu).suspend_mutex);
+		msm_cpufreq_sync(cpu);
 	}
 
 	return NOTIFY_DONE;
@@ -394,7 +491,8 @@ static struct freq_attr *msm_freq_attr[] = {
 
 static struct cpufreq_driver msm_cpufreq_driver = {
 	/* lps calculations are handled here. */
-	.flags		= CPUFREQ_STICKY | CPUFREQ_CONST_LOOPS,
+	.flags		= CPUFREQ_STICKY | CPUFREQ_CONST_LOOPS |
+			  CPUFREQ_ASYNC_TARGET,
 	.init		= msm_cpufreq_init,
 	.verify		= msm_cpufreq_verify,
 	.target		= msm_cpufreq_target,
@@ -15,6 +15,7 @@
 #include <linux/module.h>
 #include <linux/types.h>
 #include <linux/cdev.h>
+#include <linux/cpuidle.h>
 #include <linux/device.h>
 #include <linux/fs.h>
 #include <linux/hrtimer.h>
@@ -137,18 +138,19 @@ static void msm_idle_stats_pre_idle(struct msm_idle_stats_device *stats_dev)
 		return;
 	}
 
+	now = ktime_to_us(ktime_get());
+	stats_dev->stats.last_idle_start = now;
+
 	if (!atomic_read(&stats_dev->collecting))
 		return;
 
 	hrtimer_cancel(&stats_dev->timer);
 
-	now = ktime_to_us(ktime_get());
 	interval = now - stats_dev->stats.last_busy_start;
 	interval = msm_idle_stats_bound_interval(interval);
 
 	stats_dev->stats.busy_intervals[stats_dev->stats.nr_collected]
 		= (__u32) interval;
-	stats_dev->stats.last_idle_start = now;
 }
 
 static void msm_idle_stats_post_idle(struct msm_idle_stats_device *stats_dev)
@@ -163,13 +165,19 @@ static void msm_idle_stats_post_idle(struct msm_idle_stats_device *stats_dev)
 		return;
 	}
 
-	if (!atomic_read(&stats_dev->collecting))
-		return;
-
 	now = ktime_to_us(ktime_get());
 	interval = now - stats_dev->stats.last_idle_start;
 	interval = msm_idle_stats_bound_interval(interval);
 
+	/*
+	 * Let the cpuidle governor use our measurement of this idle
+	 * period, whether or not userspace is collecting right now.
+	 */
+	cpuidle_report_idle_interval(stats_dev->cpu, (unsigned int) interval);
+
+	if (!atomic_read(&stats_dev->collecting))
+		return;
+
 	stats_dev->stats.idle_intervals[stats_dev->stats.nr_collected]
 		= (__u32) interval;
 	stats_dev->stats.nr_collected++;
@@ -31,12 +31,26 @@
  */
 extern int msm_cpufreq_set_freq_limits(
 		uint32_t cpu, uint32_t min, uint32_t max);
+
+/**
+ * msm_cpufreq_sync() - Wait for queued frequency changes on cpu
+ *
+ * @cpu: The cpu core whose transition queue to drain
+ *
+ * Frequency requests return before the switch has happened; callers that
+ * need the new frequency in effect (or policy->cur updated) wait here.
+ */
+extern void msm_cpufreq_sync(uint32_t cpu);
 #else
 static inline int msm_cpufreq_set_freq_limits(
 		uint32_t cpu, uint32_t min, uint32_t max)
 {
 	return -ENOSYS;
 }
+
+static inline void msm_cpufreq_sync(uint32_t cpu)
+{
+}
 #endif
 
 #endif /* __ARCH_ARM_MACH_MSM_MACH_CPUFREQ_H */
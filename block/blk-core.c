@@ -436,6 +436,8 @@ struct request_queue *blk_alloc_queue_node(gfp_t gfp_mask, int node_id)
 		return NULL;
 	}
 
+	blk_wbt_init(q);
+
 	setup_timer(&q->backing_dev_info.laptop_mode_wb_timer,
 		    laptop_mode_timer_fn, (unsigned long) q);
 	setup_timer(&q->timeout, blk_rq_timed_out_timer, (unsigned long) q);
@@ -1039,6 +1041,7 @@ void __blk_put_request(struct request_queue *q, struct request *req)
 	if (unlikely(--req->ref_count))
 		return;
 
+	blk_wbt_done(q, req);
 	elv_completed_request(q, req);
 
 	/* this is a bio leak */
@@ -1215,6 +1218,7 @@ static int __make_request(struct request_queue *q, struct bio *bio)
 	struct blk_plug *plug;
 	int el_ret, rw_flags, where = ELEVATOR_INSERT_SORT;
 	struct request *req;
+	bool wb_throttled;
 
 	/*
 	 * low level driver can indicate that it wants pages above a
@@ -1263,6 +1267,12 @@ get_rq:
 	if (sync)
 		rw_flags |= REQ_SYNC;
 
+	/*
+	 * Background writeback may have to wait for its share of the
+	 * queue first. This drops the queue lock if it sleeps.
+	 */
+	wb_throttled = blk_wbt_wait(q, bio);
+
 	/*
 	 * Grab a free request. This is might sleep but can not fail.
 	 * Returns with the queue unlocked.
@@ -1276,6 +1286,8 @@ get_rq:
 	 * often, and the elevators are able to handle it.
 	 */
 	init_request_from_bio(req, bio);
+	if (wb_throttled)
+		req->cmd_flags |= REQ_WB_THROTTLED;
 
 	if (test_bit(QUEUE_FLAG_SAME_COMP, &q->queue_flags) ||
 	    bio_flagged(bio, BIO_CPU_AFFINE)) {
@@ -1973,6 +1985,7 @@ void blk_start_request(struct request *req)
 	if (unlikely(blk_bidi_rq(req)))
 		req->next_rq->resid_len = blk_rq_bytes(req->next_rq);
 
+	blk_wbt_issue(req);
 	blk_add_timer(req);
 }
 EXPORT_SYMBOL(blk_start_request);
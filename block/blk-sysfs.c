@@ -266,6 +266,43 @@ queue_rq_affinity_store(struct request_queue *q, const char *page, size_t count)
 	return ret;
 }
 
+#ifdef CONFIG_BLK_WBT
+static ssize_t queue_wbt_lat_show(struct request_queue *q, char *page)
+{
+	return queue_var_show(div_u64(q->wbt.min_lat_nsec, NSEC_PER_USEC),
+			      page);
+}
+
+static ssize_t
+queue_wbt_lat_store(struct request_queue *q, const char *page, size_t count)
+{
+	unsigned long usec;
+	ssize_t ret = queue_var_store(&usec, page, count);
+
+	spin_lock_irq(q->queue_lock);
+	blk_wbt_set_lat(q, (u64)usec * NSEC_PER_USEC);
+	spin_unlock_irq(q->queue_lock);
+
+	return ret;
+}
+
+static ssize_t queue_wbt_depth_show(struct request_queue *q, char *page)
+{
+	unsigned long depth;
+
+	spin_lock_irq(q->queue_lock);
+	depth = q->wbt.min_lat_nsec ? blk_wbt_depth(q) : 0;
+	spin_unlock_irq(q->queue_lock);
+
+	return queue_var_show(depth, page);
+}
+
+static ssize_t queue_wbt_inflight_show(struct request_queue *q, char *page)
+{
+	return queue_var_show(q->wbt.inflight, page);
+}
+#endif
+
 static struct queue_sysfs_entry queue_requests_entry = {
 	.attr = {.name = "nr_requests", .mode = S_IRUGO | S_IWUSR },
 	.show = queue_requests_show,
@@ -380,6 +417,24 @@ static struct queue_sysfs_entry queue_random_entry = {
 	.store = queue_store_random,
 };
 
+#ifdef CONFIG_BLK_WBT
+static struct queue_sysfs_entry queue_wbt_lat_entry = {
+	.attr = {.name = "wbt_lat_usec", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_wbt_lat_show,
+	.store = queue_wbt_lat_store,
+};
+
+static struct queue_sysfs_entry queue_wbt_depth_entry = {
+	.attr = {.name = "wbt_depth", .mode = S_IRUGO },
+	.show = queue_wbt_depth_show,
+};
+
+static struct queue_sysfs_entry queue_wbt_inflight_entry = {
+	.attr = {.name = "wbt_inflight", .mode = S_IRUGO },
+	.show = queue_wbt_inflight_show,
+};
+#endif
+
 static struct attribute *default_attrs[] = {
 	&queue_requests_entry.attr,
 	&queue_ra_entry.attr,
@@ -402,6 +457,11 @@ static struct attribute *default_attrs[] = {
 	&queue_rq_affinity_entry.attr,
 	&queue_iostats_entry.attr,
 	&queue_random_entry.attr,
+#ifdef CONFIG_BLK_WBT
+	&queue_wbt_lat_entry.attr,
+	&queue_wbt_depth_entry.attr,
+	&queue_wbt_inflight_entry.attr,
+#endif
 	NULL,
 };
 
@@ -524,6 +584,8 @@ int blk_register_queue(struct gendisk *disk)
 	if (!q->request_fn)
 		return 0;
 
+	blk_wbt_register(q);
+
 	ret = elv_register_queue(q);
 	if (ret) {
 		kobject_uevent(&q->kobj, KOBJ_REMOVE);
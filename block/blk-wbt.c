@@ -0,0 +1,214 @@
+/*
+ * Writeback throttling based on read latency
+ *
+ * balance_dirty_pages() only looks at how many pages are dirty, not at
+ * what the device makes of the writeback that follows. A device that
+ * serves a deep queue of writes in order, as eMMC does, then keeps reads
+ * waiting behind all of them, and the application stalls on a page fault
+ * while the dirty limits look perfectly healthy.
+ *
+ * Instead of guessing, watch the reads that complete on the queue. Time
+ * is cut into windows; if even the fastest read of a window took longer
+ * than the target while background writes were queued, halve the number
+ * of requests that background writeback may hold. Once reads are back
+ * under the target, or there are none to protect, double it again, one
+ * window at a time, up to nr_requests.
+ *
+ * Only async writes that are not flushes or FUA are held back: sync
+ * writes have someone waiting for them much like reads, and reclaim
+ * should not be slowed down by the very throttling it may need to
+ * relieve.
+ */
+
+#include <linux/kernel.h>
+#include <linux/blkdev.h>
+#include <linux/bio.h>
+#include <linux/ktime.h>
+#include <linux/swap.h>
+
+#include "blk.h"
+
+/* Read latencies are looked at over windows of this length */
+#define WBT_WINDOW_NSEC		(100 * NSEC_PER_MSEC)
+
+/* Default targets, set when the queue is registered */
+#define WBT_DEF_LAT_NONROT	(2 * NSEC_PER_MSEC)
+#define WBT_DEF_LAT_ROT		(75 * NSEC_PER_MSEC)
+
+static inline u64 wbt_now(void)
+{
+	return ktime_to_ns(ktime_get());
+}
+
+/*
+ * Number of requests background writeback may hold at the current scale
+ */
+unsigned long blk_wbt_depth(struct request_queue *q)
+{
+	return max(q->nr_requests >> q->wbt.scale_step, 1UL);
+}
+
+static void wbt_reset_window(struct blk_wbt *wbt, u64 now)
+{
+	wbt->win_start = now;
+	wbt->win_min_lat = 0;
+	wbt->win_reads = 0;
+	wbt->win_writes = 0;
+}
+
+static void wbt_scale_up(struct request_queue *q)
+{
+	struct blk_wbt *wbt = &q->wbt;
+
+	if (!wbt->scale_step)
+		return;
+
+	wbt->scale_step--;
+	wake_up_all(&wbt->wait);
+}
+
+static void wbt_scale_down(struct request_queue *q)
+{
+	if (blk_wbt_depth(q) > 1)
+		q->wbt.scale_step++;
+}
+
+static void wbt_window_end(struct request_queue *q, u64 now)
+{
+	struct blk_wbt *wbt = &q->wbt;
+
+	if (!wbt->win_reads) {
+		/* nothing to protect */
+		wbt_scale_up(q);
+	} else if (wbt->win_min_lat <= wbt->min_lat_nsec) {
+		wbt_scale_up(q);
+	} else if (wbt->win_writes || wbt->inflight) {
+		/*
+		 * Reads that are slow without writes around are just what
+		 * the device does; holding back writeback would not help.
+		 */
+		wbt_scale_down(q);
+	}
+
+	wbt_reset_window(wbt, now);
+}
+
+/**
+ * blk_wbt_wait - throttle background writeback
+ * @q: the queue @bio is going to
+ * @bio: the bio a request is about to be allocated for
+ *
+ * Called from __make_request() with the queue lock held, which is
+ * dropped while waiting. Returns %true if the request allocated for
+ * @bio must be marked %REQ_WB_THROTTLED.
+ */
+bool blk_wbt_wait(struct request_queue *q, struct bio *bio)
+{
+	struct blk_wbt *wbt = &q->wbt;
+	DEFINE_WAIT(wait);
+
+	if (!wbt->min_lat_nsec)
+		return false;
+	if ((bio->bi_rw & (REQ_WRITE | REQ_SYNC | REQ_FLUSH | REQ_FUA |
+			   REQ_DISCARD | REQ_SANITIZE)) != REQ_WRITE)
+		return false;
+	if (current_is_kswapd())
+		return false;
+
+	/* the target may be cleared while we wait */
+	while (wbt->min_lat_nsec && wbt->inflight >= blk_wbt_depth(q)) {
+		prepare_to_wait_exclusive(&wbt->wait, &wait,
+					  TASK_UNINTERRUPTIBLE);
+		if (!wbt->min_lat_nsec || wbt->inflight < blk_wbt_depth(q))
+			break;
+		spin_unlock_irq(q->queue_lock);
+		io_schedule();
+		spin_lock_irq(q->queue_lock);
+	}
+	finish_wait(&wbt->wait, &wait);
+
+	wbt->inflight++;
+	return true;
+}
+
+/*
+ * Called from blk_start_request() with the queue lock held
+ */
+void blk_wbt_issue(struct request *rq)
+{
+	if (rq->q->wbt.min_lat_nsec && rq->cmd_type == REQ_TYPE_FS &&
+	    rq_data_dir(rq) == READ)
+		rq->wbt_issue_ns = wbt_now();
+}
+
+/*
+ * Called from __blk_put_request() with the queue lock held, for every
+ * request that goes away. Merged requests that never reached the driver
+ * come through here too, which keeps the count of throttled writes right.
+ */
+void blk_wbt_done(struct request_queue *q, struct request *rq)
+{
+	struct blk_wbt *wbt = &q->wbt;
+	u64 now;
+
+	if (rq->cmd_flags & REQ_WB_THROTTLED) {
+		rq->cmd_flags &= ~REQ_WB_THROTTLED;
+		wbt->inflight--;
+		wbt->win_writes++;
+		if (waitqueue_active(&wbt->wait) &&
+		    wbt->inflight < blk_wbt_depth(q))
+			wake_up(&wbt->wait);
+	} else if (!rq->wbt_issue_ns) {
+		return;
+	}
+
+	if (!wbt->min_lat_nsec)
+		return;
+
+	now = wbt_now();
+	if (rq->wbt_issue_ns) {
+		u64 lat = now - rq->wbt_issue_ns;
+
+		if (!wbt->win_reads || lat < wbt->win_min_lat)
+			wbt->win_min_lat = lat;
+		wbt->win_reads++;
+		rq->wbt_issue_ns = 0;
+	}
+
+	if (now - wbt->win_start >= WBT_WINDOW_NSEC)
+		wbt_window_end(q, now);
+}
+
+/**
+ * blk_wbt_set_lat - set the read latency target
+ * @q: the queue
+ * @nsec: target in nanoseconds, 0 to disable throttling
+ *
+ * Starts over at full depth. Called with the queue lock held.
+ */
+void blk_wbt_set_lat(struct request_queue *q, u64 nsec)
+{
+	struct blk_wbt *wbt = &q->wbt;
+
+	wbt->min_lat_nsec = nsec;
+	wbt->scale_step = 0;
+	wbt_reset_window(wbt, wbt_now());
+	wake_up_all(&wbt->wait);
+}
+
+/*
+ * Called when the disk of a request based queue is registered, by which
+ * time the driver has said whether the device is rotational.
+ */
+void blk_wbt_register(struct request_queue *q)
+{
+	spin_lock_irq(q->queue_lock);
+	blk_wbt_set_lat(q, blk_queue_nonrot(q) ? WBT_DEF_LAT_NONROT :
+						 WBT_DEF_LAT_ROT);
+	spin_unlock_irq(q->queue_lock);
+}
+
+void blk_wbt_init(struct request_queue *q)
+{
+	init_waitqueue_head(&q->wbt.wait);
+}
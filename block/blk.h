@@ -49,6 +49,26 @@ static inline void blk_clear_rq_complete(struct request *rq)
  */
 #define ELV_ON_HASH(rq)		(!hlist_unhashed(&(rq)->hash))
 
+#ifdef CONFIG_BLK_WBT
+void blk_wbt_init(struct request_queue *q);
+void blk_wbt_register(struct request_queue *q);
+bool blk_wbt_wait(struct request_queue *q, struct bio *bio);
+void blk_wbt_issue(struct request *rq);
+void blk_wbt_done(struct request_queue *q, struct request *rq);
+void blk_wbt_set_lat(struct request_queue *q, u64 nsec);
+unsigned long blk_wbt_depth(struct request_queue *q);
+#else
+static inline void blk_wbt_init(struct request_queue *q) { }
+static inline void blk_wbt_register(struct request_queue *q) { }
+static inline bool blk_wbt_wait(struct request_queue *q, struct bio *bio)
+{
+	return false;
+}
+static inline void blk_wbt_issue(struct request *rq) { }
+static inline void blk_wbt_done(struct request_queue *q,
+				struct request *rq) { }
+#endif
+
 void blk_insert_flush(struct request *rq);
 void blk_abort_flushes(struct request_queue *q);
 
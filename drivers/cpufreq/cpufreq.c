@@ -28,6 +28,7 @@
 #include <linux/cpu.h>
 #include <linux/completion.h>
 #include <linux/mutex.h>
+#include <linux/ktime.h>
 #include <linux/syscore_ops.h>
 
 #include <trace/events/power.h>
@@ -49,6 +50,31 @@ static DEFINE_PER_CPU(struct cpufreq_cpu_save_data, cpufreq_policy_save);
 #endif
 static DEFINE_SPINLOCK(cpufreq_driver_lock);
 
+/*
+ * Start of the oldest frequency request not yet serviced by a transition,
+ * per policy cpu, and start of the transition in flight, per cpu. Used to
+ * report request-to-settled latency with CPUFREQ_POSTCHANGE.
+ */
+static DEFINE_PER_CPU(ktime_t, cpufreq_request_time);
+static DEFINE_PER_CPU(ktime_t, cpufreq_prechange_time);
+
+/*
+ * Reason given with the latest request per policy cpu, reported with
+ * CPUFREQ_POSTCHANGE. While cpufreq_update_policy_reason() runs, governor
+ * requests made for CPUFREQ_REASON_LIMIT are charged to its reason instead.
+ */
+static DEFINE_PER_CPU(unsigned int, cpufreq_request_reason);
+static DEFINE_PER_CPU(unsigned int, cpufreq_limit_reason);
+
+/*
+ * Counts the requests per policy cpu, so that an asynchronous driver can
+ * tell cpufreq_request_done() which one it is done with. The request
+ * state is written from the requesting and the transitioning cpu alike,
+ * hence the lock.
+ */
+static DEFINE_PER_CPU(unsigned int, cpufreq_request_count);
+static DEFINE_SPINLOCK(cpufreq_request_lock);
+
 /*
  * cpu_policy_rwsem is a per CPU reader-writer semaphore designed to cure
  * all cpufreq/hotplug/workqueue/etc related lock issues.
@@ -233,6 +259,45 @@ static inline void adjust_jiffies(unsigned long val, struct cpufreq_freqs *ci)
  * function. It is called twice on all CPU frequency changes that have
  * external effects.
  */
+/*
+ * Whether @freqs carries out the latest request made for @policy, after
+ * which its start time and reason are done with. Drivers without
+ * CPUFREQ_ASYNC_TARGET transition from within ->target, where no newer
+ * request can come in. Called with cpufreq_request_lock held.
+ */
+static bool cpufreq_request_serviced(struct cpufreq_policy *policy,
+				     struct cpufreq_freqs *freqs)
+{
+	if (!(cpufreq_driver->flags & CPUFREQ_ASYNC_TARGET))
+		return true;
+
+	return per_cpu(cpufreq_request_count, policy->cpu) == freqs->seq;
+}
+
+static unsigned int cpufreq_transition_latency(struct cpufreq_policy *policy,
+					       struct cpufreq_freqs *freqs)
+{
+	ktime_t start = per_cpu(cpufreq_prechange_time, freqs->cpu);
+	ktime_t *req = NULL;
+
+	if (policy)
+		req = &per_cpu(cpufreq_request_time, policy->cpu);
+
+	spin_lock(&cpufreq_request_lock);
+	if (req && req->tv64) {
+		start = *req;
+		if (policy->cpu == freqs->cpu &&
+		    cpufreq_request_serviced(policy, freqs))
+			req->tv64 = 0;
+	}
+	spin_unlock(&cpufreq_request_lock);
+
+	if (!start.tv64)
+		return 0;
+
+	return (unsigned int) ktime_us_delta(ktime_get(), start);
+}
+
 void cpufreq_notify_transition(struct cpufreq_freqs *freqs, unsigned int state)
 {
 	struct cpufreq_policy *policy;
@@ -260,12 +325,19 @@ void cpufreq_notify_transition(struct cpufreq_freqs *freqs, unsigned int state)
 				freqs->old = policy->cur;
 			}
 		}
+		per_cpu(cpufreq_prechange_time, freqs->cpu) = ktime_get();
 		srcu_notifier_call_chain(&cpufreq_transition_notifier_list,
 				CPUFREQ_PRECHANGE, freqs);
 		adjust_jiffies(CPUFREQ_PRECHANGE, freqs);
 		break;
 
 	case CPUFREQ_POSTCHANGE:
+		spin_lock(&cpufreq_request_lock);
+		freqs->reason = policy ?
+			per_cpu(cpufreq_request_reason, policy->cpu) :
+			CPUFREQ_REASON_UNKNOWN;
+		spin_unlock(&cpufreq_request_lock);
+		freqs->latency_us = cpufreq_transition_latency(policy, freqs);
 		adjust_jiffies(CPUFREQ_POSTCHANGE, freqs);
 		pr_debug("FREQ: %lu - CPU: %lu", (unsigned long)freqs->new,
 			(unsigned long)freqs->cpu);
@@ -275,12 +347,52 @@ void cpufreq_notify_transition(struct cpufreq_freqs *freqs, unsigned int state)
 				CPUFREQ_POSTCHANGE, freqs);
 		if (likely(policy) && likely(policy->cpu == freqs->cpu)) {
 			policy->cur = freqs->new;
+			spin_lock(&cpufreq_request_lock);
+			if (cpufreq_request_serviced(policy, freqs))
+				per_cpu(cpufreq_request_reason, policy->cpu) =
+					CPUFREQ_REASON_UNKNOWN;
+			spin_unlock(&cpufreq_request_lock);
 			sysfs_notify(&policy->kobj, NULL, "scaling_cur_freq");
 		}
 		break;
 	}
 }
 EXPORT_SYMBOL_GPL(cpufreq_notify_transition);
+
+/**
+ * cpufreq_request_seq - sequence number of the latest request
+ * @cpu: the policy cpu
+ *
+ * Called by drivers from ->target, to be handed back in the
+ * cpufreq_freqs of the transition carrying the request out, or to
+ * cpufreq_request_done() if there is none.
+ */
+unsigned int cpufreq_request_seq(unsigned int cpu)
+{
+	return ACCESS_ONCE(per_cpu(cpufreq_request_count, cpu));
+}
+EXPORT_SYMBOL_GPL(cpufreq_request_seq);
+
+/**
+ * cpufreq_request_done - a request was resolved without a transition
+ * @cpu: the policy cpu the request was made for
+ * @seq: cpufreq_request_seq() of that request
+ *
+ * Drivers with CPUFREQ_ASYNC_TARGET call this when a queued request turns
+ * out to need no frequency change, so that its start time is not charged
+ * to the next transition. Nothing is cleared if a newer request came in
+ * meanwhile: its start time and reason are still to be reported.
+ */
+void cpufreq_request_done(unsigned int cpu, unsigned int seq)
+{
+	spin_lock(&cpufreq_request_lock);
+	if (per_cpu(cpufreq_request_count, cpu) == seq) {
+		per_cpu(cpufreq_request_time, cpu).tv64 = 0;
+		per_cpu(cpufreq_request_reason, cpu) = CPUFREQ_REASON_UNKNOWN;
+	}
+	spin_unlock(&cpufreq_request_lock);
+}
+EXPORT_SYMBOL_GPL(cpufreq_request_done);
 /**
  * cpufreq_notify_utilization - notify CPU userspace about CPU utilization
  * change
@@ -1478,19 +1590,55 @@ EXPORT_SYMBOL(cpufreq_unregister_notifier);
  *********************************************************************/
 
 
-int __cpufreq_driver_target(struct cpufreq_policy *policy,
-			    unsigned int target_freq,
-			    unsigned int relation)
+/**
+ * __cpufreq_driver_target_reason - pass a target to the driver
+ * @reason: CPUFREQ_REASON_* reported to transition notifiers
+ *
+ * Like __cpufreq_driver_target(), for governors that tell why they change
+ * the frequency. If requests are coalesced by an asynchronous driver, the
+ * reason of the latest one is reported.
+ */
+int __cpufreq_driver_target_reason(struct cpufreq_policy *policy,
+				   unsigned int target_freq,
+				   unsigned int relation,
+				   unsigned int reason)
 {
 	int retval = -EINVAL;
 
-	pr_debug("target for CPU %u: %u kHz, relation %u\n", policy->cpu,
-		target_freq, relation);
-	if (cpu_online(policy->cpu) && cpufreq_driver->target)
+	pr_debug("target for CPU %u: %u kHz, relation %u, reason %u\n",
+		policy->cpu, target_freq, relation, reason);
+	if (cpu_online(policy->cpu) && cpufreq_driver->target) {
+		ktime_t *req = &per_cpu(cpufreq_request_time, policy->cpu);
+		unsigned int seq;
+
+		if (reason == CPUFREQ_REASON_LIMIT &&
+		    per_cpu(cpufreq_limit_reason, policy->cpu))
+			reason = per_cpu(cpufreq_limit_reason, policy->cpu);
+
+		spin_lock(&cpufreq_request_lock);
+		per_cpu(cpufreq_request_reason, policy->cpu) = reason;
+		if (!req->tv64)
+			*req = ktime_get();
+		seq = ++per_cpu(cpufreq_request_count, policy->cpu);
+		spin_unlock(&cpufreq_request_lock);
+
 		retval = cpufreq_driver->target(policy, target_freq, relation);
 
+		if (!(cpufreq_driver->flags & CPUFREQ_ASYNC_TARGET))
+			cpufreq_request_done(policy->cpu, seq);
+	}
+
 	return retval;
 }
+EXPORT_SYMBOL_GPL(__cpufreq_driver_target_reason);
+
+int __cpufreq_driver_target(struct cpufreq_policy *policy,
+			    unsigned int target_freq,
+			    unsigned int relation)
+{
+	return __cpufreq_driver_target_reason(policy, target_freq, relation,
+					      CPUFREQ_REASON_UNKNOWN);
+}
 EXPORT_SYMBOL_GPL(__cpufreq_driver_target);
 
 int cpufreq_driver_target(struct cpufreq_policy *policy,
@@ -1761,6 +1909,20 @@ error_out:
  *	at different times.
  */
 int cpufreq_update_policy(unsigned int cpu)
+{
+	return cpufreq_update_policy_reason(cpu, CPUFREQ_REASON_LIMIT);
+}
+EXPORT_SYMBOL(cpufreq_update_policy);
+
+/**
+ * cpufreq_update_policy_reason - re-evaluate an existing cpufreq policy
+ * @cpu: CPU which shall be re-evaluated
+ * @reason: CPUFREQ_REASON_* charged to the resulting limit transitions
+ *
+ * Like cpufreq_update_policy(), for callers such as thermal mitigation
+ * whose limit changes should be told apart in the statistics.
+ */
+int cpufreq_update_policy_reason(unsigned int cpu, unsigned int reason)
 {
 	struct cpufreq_policy *data = cpufreq_cpu_get(cpu);
 	struct cpufreq_policy policy;
@@ -1797,7 +1959,9 @@ int cpufreq_update_policy(unsigned int cpu)
 		}
 	}
 
+	per_cpu(cpufreq_limit_reason, data->cpu) = reason;
 	ret = __cpufreq_set_policy(data, &policy);
+	per_cpu(cpufreq_limit_reason, data->cpu) = CPUFREQ_REASON_UNKNOWN;
 
 	unlock_policy_rwsem_write(cpu);
 
@@ -1806,7 +1970,7 @@ fail:
 no_policy:
 	return ret;
 }
-EXPORT_SYMBOL(cpufreq_update_policy);
+EXPORT_SYMBOL(cpufreq_update_policy_reason);
 
 static int __cpuinit cpufreq_cpu_callback(struct notifier_block *nfb,
 					unsigned long action, void *hcpu)
@@ -19,6 +19,7 @@
 #include <linux/cpufreq.h>
 #include <linux/platform_device.h>
 #include <mach/msm_dcvs.h>
+#include <mach/cpufreq.h>
 
 struct msm_gov {
 	int cpu;
@@ -38,14 +39,14 @@ static void msm_gov_check_limits(struct cpufreq_policy *policy)
 	struct msm_gov *gov = &per_cpu(msm_gov_info, policy->cpu);
 
 	if (policy->max < gov->cur_freq)
-		__cpufreq_driver_target(policy, policy->max,
-				CPUFREQ_RELATION_H);
+		__cpufreq_driver_target_reason(policy, policy->max,
+				CPUFREQ_RELATION_H, CPUFREQ_REASON_LIMIT);
 	else if (policy->min > gov->min_freq)
-		__cpufreq_driver_target(policy, policy->min,
-				CPUFREQ_RELATION_L);
+		__cpufreq_driver_target_reason(policy, policy->min,
+				CPUFREQ_RELATION_L, CPUFREQ_REASON_LIMIT);
 	else
-		__cpufreq_driver_target(policy, gov->cur_freq,
-				CPUFREQ_RELATION_L);
+		__cpufreq_driver_target_reason(policy, gov->cur_freq,
+				CPUFREQ_RELATION_L, CPUFREQ_REASON_LIMIT);
 
 	gov->cur_freq = policy->cur;
 	gov->min_freq = policy->min;
@@ -66,7 +67,10 @@ static int msm_dcvs_freq_set(struct msm_dcvs_freq *self,
 	if (freq > gov->max_freq)
 		freq = gov->max_freq;
 
-	ret = __cpufreq_driver_target(gov->policy, freq, CPUFREQ_RELATION_L);
+	ret = __cpufreq_driver_target_reason(gov->policy, freq,
+			CPUFREQ_RELATION_L, CPUFREQ_REASON_LOAD);
+	/* DCVS reports the achieved frequency and switch time to TZ */
+	msm_cpufreq_sync(gov->cpu);
 	gov->cur_freq = gov->policy->cur;
 
 	mutex_unlock(&per_cpu(gov_mutex, gov->cpu));
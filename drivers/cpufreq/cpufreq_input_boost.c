@@ -0,0 +1,336 @@
+/*
+ *  drivers/cpufreq/cpufreq_input_boost.c
+ *
+ *  Governor independent CPU frequency boost on user input.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * An input event raises the minimum frequency of every online CPU's
+ * policy to its configured boost frequency. The boost is applied as a
+ * policy limit through a CPUFREQ_ADJUST notifier, so every governor honors
+ * it the same way it honors scaling_min_freq, without waiting for its next
+ * sampling window.
+ *
+ * The boost lasts input_boost_ms after the last input event. A CPU that
+ * goes idle once no input has arrived for input_boost_idle_ms drops its
+ * boost early, so a finished interaction does not hold the frequency up.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/input.h>
+#include <linux/jiffies.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+struct input_boost_info {
+	unsigned int cpu;
+	unsigned int freq;	/* boost frequency in kHz, 0 to not boost */
+	bool boosted;		/* boost currently applied to the policy */
+	struct work_struct idle_work;
+};
+
+static DEFINE_PER_CPU(struct input_boost_info, input_boost_info);
+
+static unsigned int input_boost_ms = 40;
+module_param(input_boost_ms, uint, 0644);
+
+static unsigned int input_boost_idle_ms = 20;
+module_param(input_boost_idle_ms, uint, 0644);
+
+static unsigned long last_input_jiffies;
+static struct workqueue_struct *input_boost_wq;
+static struct work_struct input_boost_work;
+static struct delayed_work input_boost_rem;
+
+/*
+ * input_boost_freq takes either a single frequency for all CPUs or a list
+ * of "cpu:freq" pairs, e.g. "0:1026000 1:918000".
+ */
+static int set_input_boost_freq(const char *buf, const struct kernel_param *kp)
+{
+	unsigned int cpu, freq;
+	const char *cp = buf;
+	int ntokens = 0;
+
+	if (!*buf)
+		return -EINVAL;
+
+	while ((cp = strpbrk(cp + 1, " :")))
+		ntokens++;
+
+	if (!ntokens) {
+		if (sscanf(buf, "%u", &freq) != 1)
+			return -EINVAL;
+		for_each_possible_cpu(cpu)
+			per_cpu(input_boost_info, cpu).freq = freq;
+		return 0;
+	}
+
+	/* "cpu:freq" pairs: one ':' and one separator per pair but the last */
+	if (!(ntokens % 2))
+		return -EINVAL;
+
+	cp = buf;
+	while (cp) {
+		if (sscanf(cp, "%u:%u", &cpu, &freq) != 2)
+			return -EINVAL;
+		if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+			return -EINVAL;
+		per_cpu(input_boost_info, cpu).freq = freq;
+		cp = strchr(cp, ' ');
+		if (cp)
+			cp++;
+	}
+
+	return 0;
+}
+
+static int get_input_boost_freq(char *buf, const struct kernel_param *kp)
+{
+	int cnt = 0, cpu;
+
+	for_each_possible_cpu(cpu)
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "%d:%u ", cpu,
+				per_cpu(input_boost_info, cpu).freq);
+	if (cnt)
+		cnt--;
+	cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "\n");
+	return cnt;
+}
+
+static struct kernel_param_ops param_ops_input_boost_freq = {
+	.set = set_input_boost_freq,
+	.get = get_input_boost_freq,
+};
+module_param_cb(input_boost_freq, &param_ops_input_boost_freq, NULL, 0644);
+
+static int boost_adjust_notify(struct notifier_block *nb, unsigned long val,
+			       void *data)
+{
+	struct cpufreq_policy *policy = data;
+	struct input_boost_info *b = &per_cpu(input_boost_info, policy->cpu);
+	unsigned int min;
+
+	if (val != CPUFREQ_ADJUST || !b->boosted)
+		return NOTIFY_OK;
+
+	min = min(b->freq, policy->max);
+	if (policy->min < min)
+		policy->min = min;
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block boost_adjust_nb = {
+	.notifier_call = boost_adjust_notify,
+};
+
+static void input_boost_set(struct input_boost_info *b, bool boosted)
+{
+	if (b->boosted == boosted)
+		return;
+
+	b->boosted = boosted;
+	if (cpu_online(b->cpu))
+		cpufreq_update_policy_reason(b->cpu, CPUFREQ_REASON_INPUT);
+}
+
+static void do_input_boost(struct work_struct *work)
+{
+	unsigned int cpu;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		struct input_boost_info *b = &per_cpu(input_boost_info, cpu);
+
+		if (b->freq)
+			input_boost_set(b, true);
+	}
+	put_online_cpus();
+
+	queue_delayed_work(input_boost_wq, &input_boost_rem,
+			   msecs_to_jiffies(input_boost_ms));
+}
+
+static void do_input_boost_rem(struct work_struct *work)
+{
+	unsigned long end = last_input_jiffies +
+			    msecs_to_jiffies(input_boost_ms);
+	unsigned int cpu;
+
+	/* Input kept arriving: hold the boost until it has been quiet */
+	if (time_before(jiffies, end)) {
+		queue_delayed_work(input_boost_wq, &input_boost_rem,
+				   end - jiffies);
+		return;
+	}
+
+	get_online_cpus();
+	for_each_possible_cpu(cpu)
+		input_boost_set(&per_cpu(input_boost_info, cpu), false);
+	put_online_cpus();
+}
+
+static void do_input_boost_idle(struct work_struct *work)
+{
+	struct input_boost_info *b =
+		container_of(work, struct input_boost_info, idle_work);
+
+	get_online_cpus();
+	input_boost_set(b, false);
+	put_online_cpus();
+}
+
+static int input_boost_idle_notify(struct notifier_block *nb,
+				   unsigned long val, void *data)
+{
+	struct input_boost_info *b;
+
+	if (val != IDLE_START)
+		return NOTIFY_OK;
+
+	b = &per_cpu(input_boost_info, smp_processor_id());
+	if (!b->boosted || time_before(jiffies, last_input_jiffies +
+				       msecs_to_jiffies(input_boost_idle_ms)))
+		return NOTIFY_OK;
+
+	queue_work(input_boost_wq, &b->idle_work);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block input_boost_idle_nb = {
+	.notifier_call = input_boost_idle_notify,
+};
+
+static void input_boost_event(struct input_handle *handle, unsigned int type,
+			      unsigned int code, int value)
+{
+	unsigned int cpu;
+
+	last_input_jiffies = jiffies;
+
+	for_each_online_cpu(cpu) {
+		struct input_boost_info *b = &per_cpu(input_boost_info, cpu);
+
+		if (b->freq && !b->boosted) {
+			queue_work(input_boost_wq, &input_boost_work);
+			break;
+		}
+	}
+}
+
+static int input_boost_connect(struct input_handler *handler,
+		struct input_dev *dev, const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "cpufreq_input_boost";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err2;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err1;
+
+	return 0;
+err1:
+	input_unregister_handle(handle);
+err2:
+	kfree(handle);
+	return error;
+}
+
+static void input_boost_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id input_boost_ids[] = {
+	/* multi-touch touchscreen */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			BIT_MASK(ABS_MT_POSITION_X) |
+			BIT_MASK(ABS_MT_POSITION_Y) },
+	},
+	/* touchpad */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_KEYBIT |
+			INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_X)] =
+			BIT_MASK(ABS_X) | BIT_MASK(ABS_Y) },
+	},
+	/* keypad */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	{ },
+};
+
+static struct input_handler input_boost_handler = {
+	.event		= input_boost_event,
+	.connect	= input_boost_connect,
+	.disconnect	= input_boost_disconnect,
+	.name		= "cpufreq_input_boost",
+	.id_table	= input_boost_ids,
+};
+
+static int __init cpufreq_input_boost_init(void)
+{
+	unsigned int cpu;
+	int ret;
+
+	input_boost_wq = create_singlethread_workqueue("input_boost_wq");
+	if (!input_boost_wq)
+		return -ENOMEM;
+
+	INIT_WORK(&input_boost_work, do_input_boost);
+	INIT_DELAYED_WORK(&input_boost_rem, do_input_boost_rem);
+
+	for_each_possible_cpu(cpu) {
+		struct input_boost_info *b = &per_cpu(input_boost_info, cpu);
+
+		b->cpu = cpu;
+		INIT_WORK(&b->idle_work, do_input_boost_idle);
+	}
+
+	ret = cpufreq_register_notifier(&boost_adjust_nb,
+					CPUFREQ_POLICY_NOTIFIER);
+	if (ret)
+		goto err_wq;
+
+	ret = input_register_handler(&input_boost_handler);
+	if (ret)
+		goto err_notifier;
+
+	idle_notifier_register(&input_boost_idle_nb);
+	return 0;
+
+err_notifier:
+	cpufreq_unregister_notifier(&boost_adjust_nb, CPUFREQ_POLICY_NOTIFIER);
+err_wq:
+	destroy_workqueue(input_boost_wq);
+	return ret;
+}
+late_initcall(cpufreq_input_boost_init);
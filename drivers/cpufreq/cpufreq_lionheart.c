@@ -362,8 +362,9 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 		if (this_dbs_info->requested_freq > policy->max)
 			this_dbs_info->requested_freq = policy->max;
 
-		__cpufreq_driver_target(policy, this_dbs_info->requested_freq,
-			CPUFREQ_RELATION_H);
+		__cpufreq_driver_target_reason(policy,
+			this_dbs_info->requested_freq, CPUFREQ_RELATION_H,
+			CPUFREQ_REASON_LOAD);
 		return;
 	}
 
@@ -377,8 +378,9 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 		if (policy->cur == policy->min)
 			return;
 
-		__cpufreq_driver_target(policy, this_dbs_info->requested_freq,
-				CPUFREQ_RELATION_H);
+		__cpufreq_driver_target_reason(policy,
+				this_dbs_info->requested_freq, CPUFREQ_RELATION_H,
+				CPUFREQ_REASON_LOAD);
 		return;
 	}
 }
@@ -501,13 +503,15 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 	case CPUFREQ_GOV_LIMITS:
 		mutex_lock(&this_dbs_info->timer_mutex);
 		if (policy->max < this_dbs_info->cur_policy->cur)
-			__cpufreq_driver_target(
+			__cpufreq_driver_target_reason(
 					this_dbs_info->cur_policy,
-					policy->max, CPUFREQ_RELATION_H);
+					policy->max, CPUFREQ_RELATION_H,
+					CPUFREQ_REASON_LIMIT);
 		else if (policy->min > this_dbs_info->cur_policy->cur)
-			__cpufreq_driver_target(
+			__cpufreq_driver_target_reason(
 					this_dbs_info->cur_policy,
-					policy->min, CPUFREQ_RELATION_L);
+					policy->min, CPUFREQ_RELATION_L,
+					CPUFREQ_REASON_LIMIT);
 		mutex_unlock(&this_dbs_info->timer_mutex);
 
 		break;
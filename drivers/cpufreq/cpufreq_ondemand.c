@@ -247,15 +247,15 @@ static int ondemand_powersave_bias_setspeed(struct cpufreq_policy *policy,
 {
 	if (level == POWERSAVE_BIAS_MAXLEVEL) {
 		/* maximum powersave; set to lowest frequency */
-		__cpufreq_driver_target(policy,
+		__cpufreq_driver_target_reason(policy,
 			(altpolicy) ? altpolicy->min : policy->min,
-			CPUFREQ_RELATION_L);
+			CPUFREQ_RELATION_L, CPUFREQ_REASON_LIMIT);
 		return 1;
 	} else if (level == POWERSAVE_BIAS_MINLEVEL) {
 		/* minimum powersave; set to highest frequency */
-		__cpufreq_driver_target(policy,
+		__cpufreq_driver_target_reason(policy,
 			(altpolicy) ? altpolicy->max : policy->max,
-			CPUFREQ_RELATION_H);
+			CPUFREQ_RELATION_H, CPUFREQ_REASON_LIMIT);
 		return 1;
 	}
 	return 0;
@@ -582,8 +582,9 @@ static void dbs_freq_increase(struct cpufreq_policy *p, unsigned int freq)
 	else if (p->cur == p->max)
 		return;
 
-	__cpufreq_driver_target(p, freq, dbs_tuners_ins.powersave_bias ?
-			CPUFREQ_RELATION_L : CPUFREQ_RELATION_H);
+	__cpufreq_driver_target_reason(p, freq, dbs_tuners_ins.powersave_bias ?
+			CPUFREQ_RELATION_L : CPUFREQ_RELATION_H,
+			CPUFREQ_REASON_LOAD);
 }
 
 #ifdef CONFIG_CPU_FREQ_GOV_ONDEMAND_2_PHASE
@@ -763,13 +764,14 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 			freq_next = policy->min;
 
 		if (!dbs_tuners_ins.powersave_bias) {
-			__cpufreq_driver_target(policy, freq_next,
-					CPUFREQ_RELATION_L);
+			__cpufreq_driver_target_reason(policy, freq_next,
+					CPUFREQ_RELATION_L,
+					CPUFREQ_REASON_LOAD);
 		} else {
 			int freq = powersave_bias_target(policy, freq_next,
 					CPUFREQ_RELATION_L);
-			__cpufreq_driver_target(policy, freq,
-				CPUFREQ_RELATION_L);
+			__cpufreq_driver_target_reason(policy, freq,
+				CPUFREQ_RELATION_L, CPUFREQ_REASON_LOAD);
 		}
 	}
 }
@@ -805,8 +807,9 @@ static void do_dbs_timer(struct work_struct *work)
 				delay -= jiffies % delay;
 		}
 	} else {
-		__cpufreq_driver_target(dbs_info->cur_policy,
-			dbs_info->freq_lo, CPUFREQ_RELATION_H);
+		__cpufreq_driver_target_reason(dbs_info->cur_policy,
+			dbs_info->freq_lo, CPUFREQ_RELATION_H,
+			CPUFREQ_REASON_LOAD);
 		delay = dbs_info->freq_lo_jiffies;
 	}
 	schedule_delayed_work_on(cpu, &dbs_info->work, delay);
@@ -873,8 +876,9 @@ static void dbs_refresh_callback(struct work_struct *unused)
 	}
 
 	if (policy->cur < input_event_min_freq) {
-		__cpufreq_driver_target(policy, input_event_min_freq,
-					CPUFREQ_RELATION_L);
+		__cpufreq_driver_target_reason(policy, input_event_min_freq,
+					CPUFREQ_RELATION_L,
+					CPUFREQ_REASON_INPUT);
 		this_dbs_info->prev_cpu_idle = get_cpu_idle_time(cpu,
 				&this_dbs_info->prev_cpu_wall);
 	}
@@ -1063,11 +1067,13 @@ static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 	case CPUFREQ_GOV_LIMITS:
 		mutex_lock(&this_dbs_info->timer_mutex);
 		if (policy->max < this_dbs_info->cur_policy->cur)
-			__cpufreq_driver_target(this_dbs_info->cur_policy,
-				policy->max, CPUFREQ_RELATION_H);
+			__cpufreq_driver_target_reason(this_dbs_info->cur_policy,
+				policy->max, CPUFREQ_RELATION_H,
+				CPUFREQ_REASON_LIMIT);
 		else if (policy->min > this_dbs_info->cur_policy->cur)
-			__cpufreq_driver_target(this_dbs_info->cur_policy,
-				policy->min, CPUFREQ_RELATION_L);
+			__cpufreq_driver_target_reason(this_dbs_info->cur_policy,
+				policy->min, CPUFREQ_RELATION_L,
+				CPUFREQ_REASON_LIMIT);
 		else if (dbs_tuners_ins.powersave_bias != 0)
 			ondemand_powersave_bias_setspeed(
 				this_dbs_info->cur_policy,
@@ -24,8 +24,9 @@ static int cpufreq_governor_performance(struct cpufreq_policy *policy,
 	case CPUFREQ_GOV_LIMITS:
 		pr_debug("setting to %u kHz because of event %u\n",
 						policy->max, event);
-		__cpufreq_driver_target(policy, policy->max,
-						CPUFREQ_RELATION_H);
+		__cpufreq_driver_target_reason(policy, policy->max,
+						CPUFREQ_RELATION_H,
+						CPUFREQ_REASON_LIMIT);
 		break;
 	default:
 		break;
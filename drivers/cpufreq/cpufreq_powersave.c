@@ -23,8 +23,9 @@ static int cpufreq_governor_powersave(struct cpufreq_policy *policy,
 	case CPUFREQ_GOV_LIMITS:
 		pr_debug("setting to %u kHz because of event %u\n",
 							policy->min, event);
-		__cpufreq_driver_target(policy, policy->min,
-						CPUFREQ_RELATION_L);
+		__cpufreq_driver_target_reason(policy, policy->min,
+						CPUFREQ_RELATION_L,
+						CPUFREQ_REASON_LIMIT);
 		break;
 	default:
 		break;
@@ -262,7 +262,8 @@ inline static int target_freq(struct cpufreq_policy *policy, struct smartass_inf
 	}
 	else target = new_freq;
 
-	__cpufreq_driver_target(policy, target, prefered_relation);
+	__cpufreq_driver_target_reason(policy, target, prefered_relation,
+			CPUFREQ_REASON_LOAD);
 
 	dprintk(SMARTASS_DEBUG_JUMPS,"SmartassQ: jumping from %d to %d => %d (%d)\n",
 		old_freq,new_freq,target,policy->cur);
@@ -719,13 +720,15 @@ static int cpufreq_governor_smartass(struct cpufreq_policy *new_policy,
 
 		if (this_smartass->cur_policy->cur > new_policy->max) {
 			dprintk(SMARTASS_DEBUG_JUMPS,"SmartassI: jumping to new max freq: %d\n",new_policy->max);
-			__cpufreq_driver_target(this_smartass->cur_policy,
-						new_policy->max, CPUFREQ_RELATION_H);
+			__cpufreq_driver_target_reason(this_smartass->cur_policy,
+						new_policy->max, CPUFREQ_RELATION_H,
+						CPUFREQ_REASON_LIMIT);
 		}
 		else if (this_smartass->cur_policy->cur < new_policy->min) {
 			dprintk(SMARTASS_DEBUG_JUMPS,"SmartassI: jumping to new min freq: %d\n",new_policy->min);
-			__cpufreq_driver_target(this_smartass->cur_policy,
-						new_policy->min, CPUFREQ_RELATION_L);
+			__cpufreq_driver_target_reason(this_smartass->cur_policy,
+						new_policy->min, CPUFREQ_RELATION_L,
+						CPUFREQ_REASON_LIMIT);
 		}
 
 		if (this_smartass->cur_policy->cur < new_policy->max && !timer_pending(&this_smartass->timer))
@@ -766,8 +769,9 @@ static void smartass_suspend(int cpu, int suspend)
 
 		dprintk(SMARTASS_DEBUG_JUMPS,"SmartassS: awaking at %d\n",new_freq);
 
-		__cpufreq_driver_target(policy, new_freq,
-					CPUFREQ_RELATION_L);
+		__cpufreq_driver_target_reason(policy, new_freq,
+					CPUFREQ_RELATION_L,
+					CPUFREQ_REASON_BOOST);
 	} else {
 		// to avoid wakeup issues with quick sleep/wakeup don't change actual frequency when entering sleep
 		// to allow some time to settle down. Instead we just reset our statistics (and reset the timer).
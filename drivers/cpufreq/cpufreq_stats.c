@@ -20,6 +20,7 @@
 #include <linux/kobject.h>
 #include <linux/spinlock.h>
 #include <linux/notifier.h>
+#include <linux/hrtimer.h>
 #include <asm/cputime.h>
 
 static spinlock_t cpufreq_stats_lock;
@@ -37,6 +38,25 @@ static unsigned int cpu1_total_trans;
 static unsigned int temp_cpu0_total_trans;
 static unsigned int temp_cpu1_total_trans;
 
+/*
+ * Histogram buckets are powers of two: bucket 0 counts values below the
+ * base, bucket i values in [base << (i - 1), base << i), and the last
+ * bucket everything above. Latencies are in us, residencies in ms.
+ */
+#define CPUFREQ_STATS_LAT_BASE_US	32
+#define CPUFREQ_STATS_LAT_BUCKETS	12
+#define CPUFREQ_STATS_RES_BASE_MS	1
+#define CPUFREQ_STATS_RES_BUCKETS	11
+
+static const char * const cpufreq_reason_names[CPUFREQ_REASON_NR] = {
+	[CPUFREQ_REASON_UNKNOWN]	= "unknown",
+	[CPUFREQ_REASON_LOAD]		= "load",
+	[CPUFREQ_REASON_BOOST]		= "boost",
+	[CPUFREQ_REASON_INPUT]		= "input",
+	[CPUFREQ_REASON_LIMIT]		= "limit",
+	[CPUFREQ_REASON_THERMAL]	= "thermal",
+};
+
 struct cpufreq_stats {
 	unsigned int cpu;
 	unsigned int total_trans;
@@ -44,8 +64,15 @@ struct cpufreq_stats {
 	unsigned int max_state;
 	unsigned int state_num;
 	unsigned int last_index;
+	unsigned int latency_count;
+	unsigned long long latency_total_us;
+	unsigned int latency_max_us;
+	unsigned int latency_hist[CPUFREQ_STATS_LAT_BUCKETS];
+	unsigned int reason_trans[CPUFREQ_REASON_NR];
+	ktime_t entry_time;
 	cputime64_t *time_in_state;
 	unsigned int *freq_table;
+	unsigned int *res_hist;
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	unsigned int *trans_table;
 #endif
@@ -89,6 +116,85 @@ static ssize_t show_total_trans(struct cpufreq_policy *policy, char *buf)
 			per_cpu(cpufreq_stats_table, stat->cpu)->total_trans);
 }
 
+static ssize_t show_trans_latency(struct cpufreq_policy *policy, char *buf)
+{
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	if (!stat)
+		return 0;
+	return sprintf(buf, "count %u\ntotal_us %llu\nmax_us %u\n",
+			stat->latency_count, stat->latency_total_us,
+			stat->latency_max_us);
+}
+
+static unsigned int cpufreq_stats_bucket(unsigned int val, unsigned int base,
+					 unsigned int nr)
+{
+	unsigned int i = fls(val / base);
+
+	return min(i, nr - 1);
+}
+
+static ssize_t show_trans_latency_hist(struct cpufreq_policy *policy,
+				       char *buf)
+{
+	ssize_t len = 0;
+	int i;
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	if (!stat)
+		return 0;
+	for (i = 0; i < CPUFREQ_STATS_LAT_BUCKETS; i++)
+		len += sprintf(buf + len, "%u %u\n",
+			i ? CPUFREQ_STATS_LAT_BASE_US << (i - 1) : 0,
+			stat->latency_hist[i]);
+	return len;
+}
+
+static ssize_t show_trans_reason(struct cpufreq_policy *policy, char *buf)
+{
+	ssize_t len = 0;
+	int i;
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	if (!stat)
+		return 0;
+	for (i = 0; i < CPUFREQ_REASON_NR; i++)
+		len += sprintf(buf + len, "%s %u\n", cpufreq_reason_names[i],
+			stat->reason_trans[i]);
+	return len;
+}
+
+static ssize_t show_residency_hist(struct cpufreq_policy *policy, char *buf)
+{
+	ssize_t len = 0;
+	int i, j;
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	if (!stat)
+		return 0;
+	len += snprintf(buf + len, PAGE_SIZE - len, "%9s:", "ms");
+	for (j = 0; j < CPUFREQ_STATS_RES_BUCKETS; j++)
+		len += snprintf(buf + len, PAGE_SIZE - len, " %7u",
+			j ? CPUFREQ_STATS_RES_BASE_MS << (j - 1) : 0);
+	len += snprintf(buf + len, PAGE_SIZE - len, "\n");
+
+	for (i = 0; i < stat->state_num; i++) {
+		if (len >= PAGE_SIZE)
+			break;
+		len += snprintf(buf + len, PAGE_SIZE - len, "%9u:",
+				stat->freq_table[i]);
+		for (j = 0; j < CPUFREQ_STATS_RES_BUCKETS; j++) {
+			if (len >= PAGE_SIZE)
+				break;
+			len += snprintf(buf + len, PAGE_SIZE - len, " %7u",
+				stat->res_hist[i * CPUFREQ_STATS_RES_BUCKETS + j]);
+		}
+		if (len >= PAGE_SIZE)
+			break;
+		len += snprintf(buf + len, PAGE_SIZE - len, "\n");
+	}
+	if (len >= PAGE_SIZE)
+		return PAGE_SIZE;
+	return len;
+}
+
 static ssize_t show_cpu1_total_trans(struct cpufreq_policy *policy, char *buf)
 {
        return sprintf(buf, "%d\n", cpu1_total_trans);
@@ -215,12 +321,20 @@ CPUFREQ_STATDEVICE_ATTR(trans_table, 0444, show_trans_table);
 #endif
 
 CPUFREQ_STATDEVICE_ATTR(total_trans, 0444, show_total_trans);
+CPUFREQ_STATDEVICE_ATTR(trans_latency, 0444, show_trans_latency);
+CPUFREQ_STATDEVICE_ATTR(trans_latency_hist, 0444, show_trans_latency_hist);
+CPUFREQ_STATDEVICE_ATTR(trans_reason, 0444, show_trans_reason);
+CPUFREQ_STATDEVICE_ATTR(residency_hist, 0444, show_residency_hist);
 CPUFREQ_STATDEVICE_ATTR(cpu1_time_in_state, 0444, show_cpu1_time_in_state);
 CPUFREQ_STATDEVICE_ATTR(cpu1_total_trans, 0444, show_cpu1_total_trans);
 CPUFREQ_STATDEVICE_ATTR(time_in_state, 0444, show_time_in_state);
 
 static struct attribute *default_attrs[] = {
 	&_attr_total_trans.attr,
+	&_attr_trans_latency.attr,
+	&_attr_trans_latency_hist.attr,
+	&_attr_trans_reason.attr,
+	&_attr_residency_hist.attr,
 	&_attr_time_in_state.attr,
 	&_attr_cpu1_time_in_state.attr,
 	&_attr_cpu1_total_trans.attr,
@@ -304,6 +418,7 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 	}
 
 	alloc_size = count * sizeof(int) + count * sizeof(cputime64_t);
+	alloc_size += count * CPUFREQ_STATS_RES_BUCKETS * sizeof(int);
 
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	alloc_size += count * count * sizeof(int);
@@ -315,9 +430,10 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 		goto error_out;
 	}
 	stat->freq_table = (unsigned int *)(stat->time_in_state + count);
+	stat->res_hist = stat->freq_table + count;
 
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
-	stat->trans_table = stat->freq_table + count;
+	stat->trans_table = stat->res_hist + count * CPUFREQ_STATS_RES_BUCKETS;
 #endif
 	j = 0;
 	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
@@ -330,6 +446,7 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 	stat->state_num = j;
 	spin_lock(&cpufreq_stats_lock);
 	stat->last_time = get_jiffies_64();
+	stat->entry_time = ktime_get();
 	stat->last_index = freq_table_get_index(stat, policy->cur);
 	spin_unlock(&cpufreq_stats_lock);
 	cpufreq_cpu_put(data);
@@ -366,6 +483,8 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 	struct cpufreq_freqs *freq = data;
 	struct cpufreq_stats *stat;
 	int old_index, new_index;
+	unsigned int residency_ms, bucket;
+	ktime_t now;
 
 	if (val != CPUFREQ_POSTCHANGE)
 		return 0;
@@ -386,8 +505,27 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 	if (old_index == new_index)
 		return 0;
 
+	now = ktime_get();
+	residency_ms = (unsigned int)
+		ktime_to_ms(ktime_sub(now, stat->entry_time));
+
 	spin_lock(&cpufreq_stats_lock);
 	stat->last_index = new_index;
+	bucket = cpufreq_stats_bucket(residency_ms,
+			CPUFREQ_STATS_RES_BASE_MS, CPUFREQ_STATS_RES_BUCKETS);
+	stat->res_hist[old_index * CPUFREQ_STATS_RES_BUCKETS + bucket]++;
+	stat->entry_time = now;
+	if (freq->latency_us) {
+		stat->latency_count++;
+		stat->latency_total_us += freq->latency_us;
+		if (freq->latency_us > stat->latency_max_us)
+			stat->latency_max_us = freq->latency_us;
+		bucket = cpufreq_stats_bucket(freq->latency_us,
+			CPUFREQ_STATS_LAT_BASE_US, CPUFREQ_STATS_LAT_BUCKETS);
+		stat->latency_hist[bucket]++;
+	}
+	if (freq->reason < CPUFREQ_REASON_NR)
+		stat->reason_trans[freq->reason]++;
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	stat->trans_table[old_index * stat->max_state + new_index]++;
 #endif
@@ -164,15 +164,18 @@ static int cpufreq_governor_userspace(struct cpufreq_policy *policy,
 			per_cpu(cpu_cur_freq, cpu),
 			per_cpu(cpu_set_freq, cpu));
 		if (policy->max < per_cpu(cpu_set_freq, cpu)) {
-			__cpufreq_driver_target(policy, policy->max,
-						CPUFREQ_RELATION_H);
+			__cpufreq_driver_target_reason(policy, policy->max,
+						CPUFREQ_RELATION_H,
+						CPUFREQ_REASON_LIMIT);
 		} else if (policy->min > per_cpu(cpu_set_freq, cpu)) {
-			__cpufreq_driver_target(policy, policy->min,
-						CPUFREQ_RELATION_L);
+			__cpufreq_driver_target_reason(policy, policy->min,
+						CPUFREQ_RELATION_L,
+						CPUFREQ_REASON_LIMIT);
 		} else {
-			__cpufreq_driver_target(policy,
+			__cpufreq_driver_target_reason(policy,
 						per_cpu(cpu_set_freq, cpu),
-						CPUFREQ_RELATION_L);
+						CPUFREQ_RELATION_L,
+						CPUFREQ_REASON_LIMIT);
 		}
 		per_cpu(cpu_min_freq, cpu) = policy->min;
 		per_cpu(cpu_max_freq, cpu) = policy->max;
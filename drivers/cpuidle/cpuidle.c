@@ -236,6 +236,8 @@ int cpuidle_enable_device(struct cpuidle_device *dev)
 	for (i = 0; i < dev->state_count; i++) {
 		dev->states[i].usage = 0;
 		dev->states[i].time = 0;
+		dev->states[i].too_deep = 0;
+		dev->states[i].too_shallow = 0;
 	}
 	dev->last_residency = 0;
 	dev->last_state = NULL;
@@ -280,6 +282,29 @@ void cpuidle_disable_device(struct cpuidle_device *dev)
 
 EXPORT_SYMBOL_GPL(cpuidle_disable_device);
 
+/**
+ * cpuidle_report_idle_interval - passes an externally timed idle period on
+ * @cpu: the CPU that was idle
+ * @idle_us: the measured idle duration, in microseconds
+ *
+ * Platform code that times idle periods itself (e.g. from an idle
+ * notifier) can feed its measurement to the current governor, which may
+ * prefer it over the residency returned by the state's enter routine.
+ * Must be called on @cpu with interrupts disabled.
+ */
+void cpuidle_report_idle_interval(unsigned int cpu, unsigned int idle_us)
+{
+	struct cpuidle_device *dev = per_cpu(cpuidle_devices, cpu);
+	struct cpuidle_governor *gov = cpuidle_curr_governor;
+
+	if (!dev || !dev->enabled || !gov || !gov->report)
+		return;
+
+	gov->report(dev, idle_us);
+}
+
+EXPORT_SYMBOL_GPL(cpuidle_report_idle_interval);
+
 /**
  * __cpuidle_register_device - internal register function called before register
  * and enable routines
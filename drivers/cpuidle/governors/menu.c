@@ -26,6 +26,7 @@
 #define DECAY 8
 #define MAX_INTERESTING 50000
 #define STDDEV_THRESH 400
+#define EARLY_WAKEUP_VOTES (INTERVALS / 2)
 
 
 /*
@@ -106,6 +107,29 @@
  * The iowait factor may look low, but realize that this is also already
  * represented in the system load average.
  *
+ * Idle history
+ * ------------
+ * The correction factor is an average, and averages hide bimodal behaviour:
+ * a CPU that alternates between 20us and 20ms idle periods gets a factor
+ * that is right for neither. Before committing to a state, menu therefore
+ * also asks the last 8 measured idle periods: every interval that ended
+ * before the state's target residency counts as one "early wakeup" vote,
+ * as does every task waiting for IO on this CPU (its completion interrupt
+ * is a pending wakeup the timer does not know about). If more than half of
+ * the votes say early, the state is skipped. Conversely, when the whole
+ * history outlasted the target residency and the next timer is far enough
+ * away, the state is allowed even if the corrected prediction is shorter;
+ * this lets a CPU with a steady long-idle pattern reach power collapse.
+ *
+ * Platform code that times idle periods itself (the msm idle_stats driver
+ * does) can report its measurement through cpuidle_report_idle_interval();
+ * menu then uses it in place of the residency returned by the driver.
+ *
+ * After each idle period, menu also checks whether its choice was right:
+ * waking before the chosen state's target residency counts as "too_deep",
+ * sleeping long enough for a deeper permitted state counts as
+ * "too_shallow". Both are exported per state in sysfs.
+ *
  */
 
 struct menu_device {
@@ -119,6 +143,11 @@ struct menu_device {
 	u64		correction_factor[BUCKETS];
 	u32		intervals[INTERVALS];
 	int		interval_ptr;
+	int		nr_intervals;
+	int		latency_req;
+
+	unsigned int	reported_us;
+	int		reported;
 };
 
 
@@ -214,6 +243,27 @@ static void detect_repeating_patterns(struct menu_device *data)
 		data->predicted_us = avg;
 }
 
+/*
+ * Count the reasons to expect a wakeup before @residency: recent idle
+ * periods that were shorter, plus tasks waiting for IO on this CPU.
+ * Returns -1 while the history is not yet full.
+ */
+static int early_wakeup_votes(struct menu_device *data, unsigned int residency)
+{
+	int i;
+	int votes;
+
+	if (data->nr_intervals < INTERVALS)
+		return -1;
+
+	votes = nr_iowait_cpu(smp_processor_id());
+	for (i = 0; i < INTERVALS; i++)
+		if (data->intervals[i] < residency)
+			votes++;
+
+	return votes;
+}
+
 /**
  * menu_select - selects the next idle state to enter
  * @dev: the CPU
@@ -234,6 +284,7 @@ static int menu_select(struct cpuidle_device *dev)
 
 	data->last_state_idx = 0;
 	data->exit_us = 0;
+	data->latency_req = latency_req;
 
 	/* Special case when user has set very strict latency requirement */
 	if (unlikely(latency_req == 0))
@@ -275,16 +326,28 @@ static int menu_select(struct cpuidle_device *dev)
 	 */
 	for (i = CPUIDLE_DRIVER_STATE_START; i < dev->state_count; i++) {
 		struct cpuidle_state *s = &dev->states[i];
+		int votes;
 
 		if (s->flags & CPUIDLE_FLAG_IGNORE)
 			continue;
-		if (s->target_residency > data->predicted_us)
-			continue;
 		if (s->exit_latency > latency_req)
 			continue;
-		if (s->exit_latency * multiplier > data->predicted_us)
+
+		votes = early_wakeup_votes(data, s->target_residency);
+		if (votes > EARLY_WAKEUP_VOTES)
 			continue;
 
+		if (votes == 0 && s->target_residency <= data->expected_us) {
+			/* the history says this state has always paid off */
+			if (s->exit_latency * multiplier > data->expected_us)
+				continue;
+		} else {
+			if (s->target_residency > data->predicted_us)
+				continue;
+			if (s->exit_latency * multiplier > data->predicted_us)
+				continue;
+		}
+
 		if (s->power_usage < power_usage) {
 			power_usage = s->power_usage;
 			data->last_state_idx = i;
@@ -308,6 +371,52 @@ static void menu_reflect(struct cpuidle_device *dev)
 	data->needs_update = 1;
 }
 
+/**
+ * menu_report - takes an idle period timed by the platform
+ * @dev: the CPU
+ * @idle_us: the measured idle duration
+ *
+ * Called with interrupts disabled before menu_reflect() for the same
+ * idle period.
+ */
+static void menu_report(struct cpuidle_device *dev, unsigned int idle_us)
+{
+	struct menu_device *data = &__get_cpu_var(menu_devices);
+
+	data->reported_us = idle_us;
+	data->reported = 1;
+}
+
+/*
+ * Judge the last decision in hindsight and account a misprediction
+ * against the state that was entered.
+ */
+static void menu_account_accuracy(struct cpuidle_device *dev,
+				  struct menu_device *data,
+				  unsigned int measured_us)
+{
+	struct cpuidle_state *target = &dev->states[data->last_state_idx];
+	int i;
+
+	if (measured_us < target->target_residency) {
+		target->too_deep++;
+		return;
+	}
+
+	for (i = data->last_state_idx + 1; i < dev->state_count; i++) {
+		struct cpuidle_state *s = &dev->states[i];
+
+		if (s->flags & CPUIDLE_FLAG_IGNORE)
+			continue;
+		if (s->exit_latency > data->latency_req)
+			continue;
+		if (s->target_residency <= measured_us) {
+			target->too_shallow++;
+			return;
+		}
+	}
+}
+
 /**
  * menu_update - attempts to guess what happened after entry
  * @dev: the CPU
@@ -329,6 +438,11 @@ static void menu_update(struct cpuidle_device *dev)
 	if (unlikely(!(target->flags & CPUIDLE_FLAG_TIME_VALID)))
 		last_idle_us = data->expected_us;
 
+	/* a platform measurement beats both the driver's and our guess */
+	if (data->reported) {
+		last_idle_us = data->reported_us;
+		data->reported = 0;
+	}
 
 	measured_us = last_idle_us;
 
@@ -339,6 +453,7 @@ static void menu_update(struct cpuidle_device *dev)
 	if (measured_us > data->exit_us)
 		measured_us -= data->exit_us;
 
+	menu_account_accuracy(dev, data, measured_us);
 
 	/* update our correction ratio */
 
@@ -367,6 +482,8 @@ static void menu_update(struct cpuidle_device *dev)
 	data->intervals[data->interval_ptr++] = last_idle_us;
 	if (data->interval_ptr >= INTERVALS)
 		data->interval_ptr = 0;
+	if (data->nr_intervals < INTERVALS)
+		data->nr_intervals++;
 }
 
 /**
@@ -388,6 +505,7 @@ static struct cpuidle_governor menu_governor = {
 	.enable =	menu_enable_device,
 	.select =	menu_select,
 	.reflect =	menu_reflect,
+	.report =	menu_report,
 	.owner =	THIS_MODULE,
 };
 
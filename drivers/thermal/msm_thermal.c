@@ -36,7 +36,7 @@ static int update_cpu_max_freq(int cpu, uint32_t max_freq)
 	if (ret)
 		return ret;
 
-	ret = cpufreq_update_policy(cpu);
+	ret = cpufreq_update_policy_reason(cpu, CPUFREQ_REASON_THERMAL);
 	if (ret)
 		return ret;
 
@@ -46,8 +46,8 @@
  *   - the dcache hash table
  * s_anon bl list spinlock protects:
  *   - the s_anon list (see __d_drop)
- * dcache_lru_lock protects:
- *   - the dcache lru lists and counters
+ * sb->s_dentry_lru_lock protects:
+ *   - the dentry lru list of that superblock and its counter
  * d_lock protects:
  *   - d_flags
  *   - d_name
@@ -61,7 +61,7 @@
  * Ordering:
  * dentry->d_inode->i_lock
  *   dentry->d_lock
- *     dcache_lru_lock
+ *     sb->s_dentry_lru_lock
  *     dcache_hash_bucket lock
  *     s_anon lock
  *
@@ -79,7 +79,6 @@
 int sysctl_vfs_cache_pressure __read_mostly = 100;
 EXPORT_SYMBOL_GPL(sysctl_vfs_cache_pressure);
 
-static __cacheline_aligned_in_smp DEFINE_SPINLOCK(dcache_lru_lock);
 __cacheline_aligned_in_smp DEFINE_SEQLOCK(rename_lock);
 
 EXPORT_SYMBOL(rename_lock);
@@ -116,6 +115,7 @@ struct dentry_stat_t dentry_stat = {
 };
 
 static DEFINE_PER_CPU(unsigned int, nr_dentry);
+static DEFINE_PER_CPU(unsigned int, nr_dentry_unused);
 
 #if defined(CONFIG_SYSCTL) && defined(CONFIG_PROC_FS)
 static int get_nr_dentry(void)
@@ -127,10 +127,20 @@ static int get_nr_dentry(void)
 	return sum < 0 ? 0 : sum;
 }
 
+static int get_nr_dentry_unused(void)
+{
+	int i;
+	int sum = 0;
+	for_each_possible_cpu(i)
+		sum += per_cpu(nr_dentry_unused, i);
+	return sum < 0 ? 0 : sum;
+}
+
 int proc_nr_dentry(ctl_table *table, int write, void __user *buffer,
 		   size_t *lenp, loff_t *ppos)
 {
 	dentry_stat.nr_dentry = get_nr_dentry();
+	dentry_stat.nr_unused = get_nr_dentry_unused();
 	return proc_dointvec(table, write, buffer, lenp, ppos);
 }
 #endif
@@ -226,15 +236,21 @@ static void dentry_unlink_inode(struct dentry * dentry)
 
 /*
  * dentry_lru_(add|del|move_tail) must be called with d_lock held.
+ *
+ * Each superblock has an LRU of its own, under a lock of its own, so that
+ * dput() on different filesystems does not contend. The global count of
+ * unused dentries is only read through sysctl and is kept per cpu.
  */
 static void dentry_lru_add(struct dentry *dentry)
 {
+	struct super_block *sb = dentry->d_sb;
+
 	if (list_empty(&dentry->d_lru)) {
-		spin_lock(&dcache_lru_lock);
-		list_add(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
-		dentry->d_sb->s_nr_dentry_unused++;
-		dentry_stat.nr_unused++;
-		spin_unlock(&dcache_lru_lock);
+		spin_lock(&sb->s_dentry_lru_lock);
+		list_add(&dentry->d_lru, &sb->s_dentry_lru);
+		sb->s_nr_dentry_unused++;
+		this_cpu_inc(nr_dentry_unused);
+		spin_unlock(&sb->s_dentry_lru_lock);
 	}
 }
 
@@ -243,29 +259,33 @@ static void __dentry_lru_del(struct dentry *dentry)
 	list_del_init(&dentry->d_lru);
 	dentry->d_flags &= ~DCACHE_SHRINK_LIST;
 	dentry->d_sb->s_nr_dentry_unused--;
-	dentry_stat.nr_unused--;
+	this_cpu_dec(nr_dentry_unused);
 }
 
 static void dentry_lru_del(struct dentry *dentry)
 {
+	struct super_block *sb = dentry->d_sb;
+
 	if (!list_empty(&dentry->d_lru)) {
-		spin_lock(&dcache_lru_lock);
+		spin_lock(&sb->s_dentry_lru_lock);
 		__dentry_lru_del(dentry);
-		spin_unlock(&dcache_lru_lock);
+		spin_unlock(&sb->s_dentry_lru_lock);
 	}
 }
 
 static void dentry_lru_move_tail(struct dentry *dentry)
 {
-	spin_lock(&dcache_lru_lock);
+	struct super_block *sb = dentry->d_sb;
+
+	spin_lock(&sb->s_dentry_lru_lock);
 	if (list_empty(&dentry->d_lru)) {
-		list_add_tail(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
-		dentry->d_sb->s_nr_dentry_unused++;
-		dentry_stat.nr_unused++;
+		list_add_tail(&dentry->d_lru, &sb->s_dentry_lru);
+		sb->s_nr_dentry_unused++;
+		this_cpu_inc(nr_dentry_unused);
 	} else {
-		list_move_tail(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
+		list_move_tail(&dentry->d_lru, &sb->s_dentry_lru);
 	}
-	spin_unlock(&dcache_lru_lock);
+	spin_unlock(&sb->s_dentry_lru_lock);
 }
 
 /**
@@ -723,21 +743,21 @@ static void shrink_dentry_list(struct list_head *list)
  */
 static void __shrink_dcache_sb(struct super_block *sb, int *count, int flags)
 {
-	/* called from prune_dcache() and shrink_dcache_parent() */
+	/* called from prune_dcache_sb() and shrink_dcache_parent() */
 	struct dentry *dentry;
 	LIST_HEAD(referenced);
 	LIST_HEAD(tmp);
 	int cnt = *count;
 
 relock:
-	spin_lock(&dcache_lru_lock);
+	spin_lock(&sb->s_dentry_lru_lock);
 	while (!list_empty(&sb->s_dentry_lru)) {
 		dentry = list_entry(sb->s_dentry_lru.prev,
 				struct dentry, d_lru);
 		BUG_ON(dentry->d_sb != sb);
 
 		if (!spin_trylock(&dentry->d_lock)) {
-			spin_unlock(&dcache_lru_lock);
+			spin_unlock(&sb->s_dentry_lru_lock);
 			cpu_relax();
 			goto relock;
 		}
@@ -759,92 +779,17 @@ relock:
 			if (!--cnt)
 				break;
 		}
-		cond_resched_lock(&dcache_lru_lock);
+		cond_resched_lock(&sb->s_dentry_lru_lock);
 	}
 	if (!list_empty(&referenced))
 		list_splice(&referenced, &sb->s_dentry_lru);
-	spin_unlock(&dcache_lru_lock);
+	spin_unlock(&sb->s_dentry_lru_lock);
 
 	shrink_dentry_list(&tmp);
 
 	*count = cnt;
 }
 
-/**
- * prune_dcache - shrink the dcache
- * @count: number of entries to try to free
- *
- * Shrink the dcache. This is done when we need more memory, or simply when we
- * need to unmount something (at which point we need to unuse all dentries).
- *
- * This function may fail to free any resources if all the dentries are in use.
- */
-static void prune_dcache(int count)
-{
-	struct super_block *sb, *p = NULL;
-	int w_count;
-	int unused = dentry_stat.nr_unused;
-	int prune_ratio;
-	int pruned;
-
-	if (unused == 0 || count == 0)
-		return;
-	if (count >= unused)
-		prune_ratio = 1;
-	else
-		prune_ratio = unused / count;
-	spin_lock(&sb_lock);
-	list_for_each_entry(sb, &super_blocks, s_list) {
-		if (list_empty(&sb->s_instances))
-			continue;
-		if (sb->s_nr_dentry_unused == 0)
-			continue;
-		sb->s_count++;
-		/* Now, we reclaim unused dentrins with fairness.
-		 * We reclaim them same percentage from each superblock.
-		 * We calculate number of dentries to scan on this sb
-		 * as follows, but the implementation is arranged to avoid
-		 * overflows:
-		 * number of dentries to scan on this sb =
-		 * count * (number of dentries on this sb /
-		 * number of dentries in the machine)
-		 */
-		spin_unlock(&sb_lock);
-		if (prune_ratio != 1)
-			w_count = (sb->s_nr_dentry_unused / prune_ratio) + 1;
-		else
-			w_count = sb->s_nr_dentry_unused;
-		pruned = w_count;
-		/*
-		 * We need to be sure this filesystem isn't being unmounted,
-		 * otherwise we could race with generic_shutdown_super(), and
-		 * end up holding a reference to an inode while the filesystem
-		 * is unmounted.  So we try to get s_umount, and make sure
-		 * s_root isn't NULL.
-		 */
-		if (down_read_trylock(&sb->s_umount)) {
-			if ((sb->s_root != NULL) &&
-			    (!list_empty(&sb->s_dentry_lru))) {
-				__shrink_dcache_sb(sb, &w_count,
-						DCACHE_REFERENCED);
-				pruned -= w_count;
-			}
-			up_read(&sb->s_umount);
-		}
-		spin_lock(&sb_lock);
-		if (p)
-			__put_super(p);
-		count -= pruned;
-		p = sb;
-		/* more work left to do? */
-		if (count <= 0)
-			break;
-	}
-	if (p)
-		__put_super(p);
-	spin_unlock(&sb_lock);
-}
-
 /**
  * shrink_dcache_sb - shrink dcache for a superblock
  * @sb: superblock
@@ -856,14 +801,14 @@ void shrink_dcache_sb(struct super_block *sb)
 {
 	LIST_HEAD(tmp);
 
-	spin_lock(&dcache_lru_lock);
+	spin_lock(&sb->s_dentry_lru_lock);
 	while (!list_empty(&sb->s_dentry_lru)) {
 		list_splice_init(&sb->s_dentry_lru, &tmp);
-		spin_unlock(&dcache_lru_lock);
+		spin_unlock(&sb->s_dentry_lru_lock);
 		shrink_dentry_list(&tmp);
-		spin_lock(&dcache_lru_lock);
+		spin_lock(&sb->s_dentry_lru_lock);
 	}
-	spin_unlock(&dcache_lru_lock);
+	spin_unlock(&sb->s_dentry_lru_lock);
 }
 EXPORT_SYMBOL(shrink_dcache_sb);
 
@@ -1110,7 +1055,7 @@ EXPORT_SYMBOL(have_submounts);
 /*
  * Search the dentry child list for the specified parent,
  * and move any unused dentries to the end of the unused
- * list for prune_dcache(). We descend to the next level
+ * list for the shrinker. We descend to the next level
  * whenever the d_subdirs list is non-empty and continue
  * searching.
  *
@@ -1145,7 +1090,7 @@ resume:
 
 		/* 
 		 * move only zero ref count dentries to the end 
-		 * of the unused list for prune_dcache
+		 * of the unused list for the shrinker
 		 *
 		 * Those which are presently on the shrink list, being processed
 		 * by shrink_dentry_list(), shouldn't be moved.  Otherwise the
@@ -1226,36 +1171,65 @@ void shrink_dcache_parent(struct dentry * parent)
 EXPORT_SYMBOL(shrink_dcache_parent);
 
 /*
- * Scan `sc->nr_slab_to_reclaim' dentries and return the number which remain.
+ * Scan `sc->nr_to_scan' dentries of one superblock and return the number
+ * which remain.
+ *
+ * Each superblock registers this shrinker for its own LRU, so reclaim
+ * spreads over the filesystems in proportion to their unused dentries
+ * without walking super_blocks under sb_lock.
  *
  * We need to avoid reentering the filesystem if the caller is performing a
  * GFP_NOFS allocation attempt.  One example deadlock is:
  *
- * ext2_new_block->getblk->GFP->shrink_dcache_memory->prune_dcache->
+ * ext2_new_block->getblk->GFP->prune_dcache_sb->
  * prune_one_dentry->dput->dentry_iput->iput->inode->i_sb->s_op->put_inode->
  * ext2_discard_prealloc->ext2_free_blocks->lock_super->DEADLOCK.
  *
  * In this case we return -1 to tell the caller that we baled.
  */
-static int shrink_dcache_memory(struct shrinker *shrink,
-				struct shrink_control *sc)
+static int prune_dcache_sb(struct shrinker *shrink, struct shrink_control *sc)
 {
+	struct super_block *sb;
 	int nr = sc->nr_to_scan;
-	gfp_t gfp_mask = sc->gfp_mask;
 
+	sb = container_of(shrink, struct super_block, s_dentry_shrink);
 	if (nr) {
-		if (!(gfp_mask & __GFP_FS))
+		if (!(sc->gfp_mask & __GFP_FS))
 			return -1;
-		prune_dcache(nr);
+		/*
+		 * We need to be sure this filesystem isn't being mounted or
+		 * unmounted, otherwise we could race with
+		 * generic_shutdown_super(), and end up holding a reference
+		 * to an inode while the filesystem is unmounted.  So we try
+		 * to get s_umount, and make sure s_root isn't NULL.
+		 */
+		if (!down_read_trylock(&sb->s_umount))
+			return -1;
+		if (sb->s_root && sb->s_nr_dentry_unused)
+			__shrink_dcache_sb(sb, &nr, DCACHE_REFERENCED);
+		up_read(&sb->s_umount);
 	}
 
-	return (dentry_stat.nr_unused / 100) * sysctl_vfs_cache_pressure;
+	return (sb->s_nr_dentry_unused * sysctl_vfs_cache_pressure) / 100;
 }
 
-static struct shrinker dcache_shrinker = {
-	.shrink = shrink_dcache_memory,
-	.seeks = DEFAULT_SEEKS,
-};
+/**
+ * d_lru_shrinker_init - set up the dentry LRU of a new superblock
+ * @sb: superblock being allocated
+ * @type: its filesystem type
+ *
+ * The LRU lock gets a lock class per filesystem type, so that lock_stat
+ * tells contention on, say, the root filesystem from that on a tmpfs.
+ * The shrinker is registered by sget() once @sb is on super_blocks.
+ */
+void d_lru_shrinker_init(struct super_block *sb, struct file_system_type *type)
+{
+	spin_lock_init(&sb->s_dentry_lru_lock);
+	lockdep_set_class(&sb->s_dentry_lru_lock, &type->s_dentry_lru_key);
+	INIT_LIST_HEAD(&sb->s_dentry_lru);
+	sb->s_dentry_shrink.shrink = prune_dcache_sb;
+	sb->s_dentry_shrink.seeks = DEFAULT_SEEKS;
+}
 
 /**
  * d_alloc	-	allocate a dcache entry
@@ -3069,8 +3043,6 @@ static void __init dcache_init(void)
 	 */
 	dentry_cache = KMEM_CACHE(dentry,
 		SLAB_RECLAIM_ACCOUNT|SLAB_PANIC|SLAB_MEM_SPREAD);
-	
-	register_shrinker(&dcache_shrinker);
 
 	/* Hash may have been set up in dcache_init_early */
 	if (!hashdist)
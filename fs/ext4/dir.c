@@ -24,6 +24,7 @@
 #include <linux/fs.h>
 #include <linux/jbd2.h>
 #include <linux/buffer_head.h>
+#include <linux/blkdev.h>
 #include <linux/slab.h>
 #include <linux/rbtree.h>
 #include "ext4.h"
@@ -109,6 +110,34 @@ int __ext4_check_dir_entry(const char *function, unsigned int line,
 	return 1;
 }
 
+/*
+ * Start the inode table readahead for the entries of a directory block
+ * from @offset on, before they are returned one by one.  The entries are
+ * only checked properly when they are returned; here, a bad rec_len just
+ * ends the walk.
+ */
+static void ext4_readdir_readahead(struct super_block *sb,
+				   struct buffer_head *bh, unsigned int offset)
+{
+	struct ext4_dir_entry_2 *de;
+	ext4_fsblk_t ra_block = 0;
+	struct blk_plug plug;
+	unsigned int rlen;
+
+	blk_start_plug(&plug);
+	while (offset + EXT4_DIR_REC_LEN(1) <= sb->s_blocksize) {
+		de = (struct ext4_dir_entry_2 *) (bh->b_data + offset);
+		rlen = ext4_rec_len_from_disk(de->rec_len, sb->s_blocksize);
+		if (rlen < EXT4_DIR_REC_LEN(1))
+			break;
+		if (de->inode)
+			ext4_inode_table_readahead(sb, le32_to_cpu(de->inode),
+						   &ra_block);
+		offset += rlen;
+	}
+	blk_finish_plug(&plug);
+}
+
 static int ext4_readdir(struct file *filp,
 			 void *dirent, filldir_t filldir)
 {
@@ -213,6 +242,8 @@ revalidate:
 			filp->f_version = inode->i_version;
 		}
 
+		ext4_readdir_readahead(sb, bh, offset);
+
 		while (!error && filp->f_pos < inode->i_size
 		       && offset < sb->s_blocksize) {
 			de = (struct ext4_dir_entry_2 *) (bh->b_data + offset);
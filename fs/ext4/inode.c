@@ -4832,6 +4832,44 @@ int ext4_get_inode_loc(struct inode *inode, struct ext4_iloc *iloc)
 		!ext4_test_inode_state(inode, EXT4_STATE_XATTR));
 }
 
+/*
+ * Start reading the inode table block that holds inode @ino, without
+ * waiting for it.  Readdir calls this for the entries it returns, so that
+ * the ext4_iget() of a stat(2) or open(2) that usually follows finds the
+ * block cached, and the blocks of a large directory are read in batches
+ * instead of one synchronous read per inode.  @prev is the last block
+ * asked for by the caller; consecutive inodes often share a block.
+ */
+void ext4_inode_table_readahead(struct super_block *sb, unsigned long ino,
+				ext4_fsblk_t *prev)
+{
+	struct ext4_group_desc *gdp;
+	ext4_fsblk_t block;
+	int inode_offset;
+
+	/* Inode table readahead was turned off through sysfs */
+	if (!EXT4_SB(sb)->s_inode_readahead_blks)
+		return;
+
+	/* The entry is not validated yet, it may not name a real inode */
+	if (!ext4_valid_inum(sb, ino))
+		return;
+
+	gdp = ext4_get_group_desc(sb, (ino - 1) / EXT4_INODES_PER_GROUP(sb),
+				  NULL);
+	if (!gdp)
+		return;
+
+	inode_offset = (ino - 1) % EXT4_INODES_PER_GROUP(sb);
+	block = ext4_inode_table(sb, gdp) +
+		inode_offset / EXT4_SB(sb)->s_inodes_per_block;
+	if (block == *prev)
+		return;
+	*prev = block;
+
+	sb_breadahead(sb, block);
+}
+
 void ext4_set_inode_flags(struct inode *inode)
 {
 	unsigned int flags = EXT4_I(inode)->i_flags;
@@ -26,6 +26,18 @@
 #include <linux/slab.h>
 #include <trace/events/ext4.h>
 
+/*
+ * Allocation unit that chunks are sized and aligned to: the RAID stripe if
+ * there is one, otherwise the erase block with flash_alloc, or 0 for none.
+ * The erase block size may change under us through sysfs or remount, so
+ * this is read once per allocation into ac_align.
+ */
+static inline unsigned long ext4_mb_align_blocks(struct ext4_sb_info *sbi)
+{
+	return sbi->s_stripe ? sbi->s_stripe :
+			       ACCESS_ONCE(sbi->s_mb_erase_blocks);
+}
+
 /*
  * MUSTDO:
  *   - test ext4_ext_search_left() and ext4_ext_search_right()
@@ -159,6 +171,18 @@
  * request we will hit the buddy cache which will result in this prealloc
  * space getting filled. The prealloc space is then later used for the
  * subsequent request.
+ *
+ * On flash, the unit that matters is the erase block: writing part of one
+ * makes the device move the rest. With the flash_alloc mount option, the
+ * erase block size the device reports (for eMMC, the preferred erase size
+ * from EXT_CSD, which the mmc driver exports as discard granularity) is
+ * used in place of the stripe size when none is set: locality group
+ * preallocations, which small files are packed into, are a whole erase
+ * block each, and chunks of a multiple of it are searched for on erase
+ * block boundaries. The value can be changed via
+ * /sys/fs/ext4/<partition>/mb_erase_blocks, 0 turning the alignment off.
+ * How well allocations end up aligned is shown, with the other allocator
+ * statistics, in /proc/fs/ext4/<partition>/mb_stats.
  */
 
 /*
@@ -1708,7 +1732,7 @@ int ext4_mb_find_by_goal(struct ext4_allocation_context *ac,
 	ext4_group_t group = ac->ac_g_ex.fe_group;
 	int max;
 	int err;
-	struct ext4_sb_info *sbi = EXT4_SB(ac->ac_sb);
+	unsigned long align = ac->ac_align;
 	struct ext4_free_extent ex;
 
 	if (!(ac->ac_flags & EXT4_MB_HINT_TRY_GOAL))
@@ -1722,13 +1746,14 @@ int ext4_mb_find_by_goal(struct ext4_allocation_context *ac,
 	max = mb_find_extent(e4b, 0, ac->ac_g_ex.fe_start,
 			     ac->ac_g_ex.fe_len, &ex);
 
-	if (max >= ac->ac_g_ex.fe_len && ac->ac_g_ex.fe_len == sbi->s_stripe) {
+	if (max >= ac->ac_g_ex.fe_len && align &&
+	    ac->ac_g_ex.fe_len == align) {
 		ext4_fsblk_t start;
 
 		start = ext4_group_first_block_no(ac->ac_sb, e4b->bd_group) +
 			ex.fe_start;
 		/* use do_div to get remainder (would be 64-bit modulo) */
-		if (do_div(start, sbi->s_stripe) == 0) {
+		if (do_div(start, align) == 0) {
 			ac->ac_found++;
 			ac->ac_b_ex = ex;
 			ext4_mb_use_best_found(ac, e4b);
@@ -1860,15 +1885,16 @@ void ext4_mb_complex_scan_group(struct ext4_allocation_context *ac,
 }
 
 /*
- * This is a special case for storages like raid5
- * we try to find stripe-aligned chunks for stripe-size-multiple requests
+ * This is a special case for storages like raid5 and flash
+ * we try to find stripe- or erase-block-aligned chunks for requests
+ * of a multiple of that size
  */
 static noinline_for_stack
 void ext4_mb_scan_aligned(struct ext4_allocation_context *ac,
 				 struct ext4_buddy *e4b)
 {
 	struct super_block *sb = ac->ac_sb;
-	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	unsigned long align = ac->ac_align;
 	void *bitmap = EXT4_MB_BITMAP(e4b);
 	struct ext4_free_extent ex;
 	ext4_fsblk_t first_group_block;
@@ -1876,26 +1902,26 @@ void ext4_mb_scan_aligned(struct ext4_allocation_context *ac,
 	ext4_grpblk_t i;
 	int max;
 
-	BUG_ON(sbi->s_stripe == 0);
+	BUG_ON(align == 0);
 
-	/* find first stripe-aligned block in group */
+	/* find first aligned block in group */
 	first_group_block = ext4_group_first_block_no(sb, e4b->bd_group);
 
-	a = first_group_block + sbi->s_stripe - 1;
-	do_div(a, sbi->s_stripe);
-	i = (a * sbi->s_stripe) - first_group_block;
+	a = first_group_block + align - 1;
+	do_div(a, align);
+	i = (a * align) - first_group_block;
 
 	while (i < EXT4_BLOCKS_PER_GROUP(sb)) {
 		if (!mb_test_bit(i, bitmap)) {
-			max = mb_find_extent(e4b, 0, i, sbi->s_stripe, &ex);
-			if (max >= sbi->s_stripe) {
+			max = mb_find_extent(e4b, 0, i, align, &ex);
+			if (max >= align) {
 				ac->ac_found++;
 				ac->ac_b_ex = ex;
 				ext4_mb_use_best_found(ac, e4b);
 				break;
 			}
 		}
-		i += sbi->s_stripe;
+		i += align;
 	}
 }
 
@@ -2052,8 +2078,8 @@ repeat:
 			ac->ac_groups_scanned++;
 			if (cr == 0)
 				ext4_mb_simple_scan_group(ac, &e4b);
-			else if (cr == 1 && sbi->s_stripe &&
-					!(ac->ac_g_ex.fe_len % sbi->s_stripe))
+			else if (cr == 1 && ac->ac_align &&
+					!(ac->ac_g_ex.fe_len % ac->ac_align))
 				ext4_mb_scan_aligned(ac, &e4b);
 			else
 				ext4_mb_complex_scan_group(ac, &e4b);
@@ -2194,6 +2220,81 @@ static const struct file_operations ext4_mb_seq_groups_fops = {
 	.release	= seq_release,
 };
 
+static int ext4_mb_seq_stats_show(struct seq_file *seq, void *v)
+{
+	struct super_block *sb = seq->private;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+
+	seq_printf(seq, "mb_stats: %u\n", sbi->s_mb_stats);
+	seq_printf(seq, "stripe: %lu\n", sbi->s_stripe);
+	seq_printf(seq, "erase_blocks: %u\n", sbi->s_mb_erase_blocks);
+	seq_printf(seq, "reqs: %u\n", atomic_read(&sbi->s_bal_reqs));
+	seq_printf(seq, "success: %u\n", atomic_read(&sbi->s_bal_success));
+	seq_printf(seq, "blocks: %u\n", atomic_read(&sbi->s_bal_allocated));
+	seq_printf(seq, "extents_scanned: %u\n",
+		   atomic_read(&sbi->s_bal_ex_scanned));
+	seq_printf(seq, "goal_hits: %u\n", atomic_read(&sbi->s_bal_goals));
+	seq_printf(seq, "2^n_hits: %u\n", atomic_read(&sbi->s_bal_2orders));
+	seq_printf(seq, "breaks: %u\n", atomic_read(&sbi->s_bal_breaks));
+	seq_printf(seq, "lost: %u\n", atomic_read(&sbi->s_mb_lost_chunks));
+	seq_printf(seq, "preallocated: %u\n",
+		   atomic_read(&sbi->s_mb_preallocated));
+	seq_printf(seq, "discarded: %u\n", atomic_read(&sbi->s_mb_discarded));
+	seq_printf(seq, "aligned_chunks: %u\n",
+		   atomic_read(&sbi->s_bal_aligned));
+	seq_printf(seq, "unaligned_chunks: %u\n",
+		   atomic_read(&sbi->s_bal_unaligned));
+	seq_printf(seq, "group_allocs: %u\n",
+		   atomic_read(&sbi->s_bal_group_pa));
+
+	return 0;
+}
+
+static int ext4_mb_seq_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ext4_mb_seq_stats_show, PDE(inode)->data);
+}
+
+static const struct file_operations ext4_mb_seq_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ext4_mb_seq_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/*
+ * Called at mount and when flash_alloc is toggled on remount. The erase
+ * block size is taken from the discard granularity of the device, which
+ * the mmc driver sets to the preferred erase size of the card, or else
+ * from its optimal I/O size.
+ */
+void ext4_mb_set_erase_blocks(struct super_block *sb)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct request_queue *q = bdev_get_queue(sb->s_bdev);
+	unsigned int blocks = 0;
+
+	if (!test_opt2(sb, FLASH_ALLOC))
+		goto out;
+
+	if (q) {
+		blocks = q->limits.discard_granularity >> sb->s_blocksize_bits;
+		if (!blocks)
+			blocks = queue_io_opt(q) >> sb->s_blocksize_bits;
+	}
+	if (blocks <= 1 || blocks > sbi->s_blocks_per_group) {
+		ext4_msg(sb, KERN_WARNING,
+			 "flash_alloc: no usable erase block size, ignored");
+		blocks = 0;
+		goto out;
+	}
+	ext4_msg(sb, KERN_INFO, "flash_alloc: %u block erase blocks", blocks);
+out:
+	/* allocations in flight read this once, never see it half set */
+	sbi->s_mb_erase_blocks = blocks;
+}
+
 static struct kmem_cache *get_groupinfo_cache(int blocksize_bits)
 {
 	int cache_index = blocksize_bits - EXT4_MIN_BLOCK_LOG_SIZE;
@@ -2472,6 +2573,7 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 	sbi->s_mb_stream_request = MB_DEFAULT_STREAM_THRESHOLD;
 	sbi->s_mb_order2_reqs = MB_DEFAULT_ORDER2_REQS;
 	sbi->s_mb_group_prealloc = MB_DEFAULT_GROUP_PREALLOC;
+	ext4_mb_set_erase_blocks(sb);
 
 	sbi->s_locality_groups = alloc_percpu(struct ext4_locality_group);
 	if (sbi->s_locality_groups == NULL) {
@@ -2487,9 +2589,12 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 		spin_lock_init(&lg->lg_prealloc_lock);
 	}
 
-	if (sbi->s_proc)
+	if (sbi->s_proc) {
 		proc_create_data("mb_groups", S_IRUGO, sbi->s_proc,
 				 &ext4_mb_seq_groups_fops, sb);
+		proc_create_data("mb_stats", S_IRUGO, sbi->s_proc,
+				 &ext4_mb_seq_stats_fops, sb);
+	}
 
 	if (sbi->s_journal)
 		sbi->s_journal->j_commit_callback = release_blocks_on_commit;
@@ -2572,11 +2677,19 @@ int ext4_mb_release(struct super_block *sb)
 		       "EXT4-fs: mballoc: %u preallocated, %u discarded\n",
 				atomic_read(&sbi->s_mb_preallocated),
 				atomic_read(&sbi->s_mb_discarded));
+		printk(KERN_INFO
+		       "EXT4-fs: mballoc: %u aligned, %u unaligned chunks, "
+				"%u group allocations\n",
+				atomic_read(&sbi->s_bal_aligned),
+				atomic_read(&sbi->s_bal_unaligned),
+				atomic_read(&sbi->s_bal_group_pa));
 	}
 
 	free_percpu(sbi->s_locality_groups);
-	if (sbi->s_proc)
+	if (sbi->s_proc) {
+		remove_proc_entry("mb_stats", sbi->s_proc);
 		remove_proc_entry("mb_groups", sbi->s_proc);
+	}
 
 	return 0;
 }
@@ -2831,7 +2944,8 @@ out_err:
 /*
  * here we normalize request for locality group
  * Group request are normalized to s_strip size if we set the same via mount
- * option. If not we set it to s_mb_group_prealloc which can be configured via
+ * option, or else to the erase block size with flash_alloc. If not we set
+ * it to s_mb_group_prealloc which can be configured via
  * /sys/fs/ext4/<partition>/mb_group_prealloc
  *
  * XXX: should we try to preallocate more than the group has now?
@@ -2842,8 +2956,8 @@ static void ext4_mb_normalize_group_request(struct ext4_allocation_context *ac)
 	struct ext4_locality_group *lg = ac->ac_lg;
 
 	BUG_ON(lg == NULL);
-	if (EXT4_SB(sb)->s_stripe)
-		ac->ac_g_ex.fe_len = EXT4_SB(sb)->s_stripe;
+	if (ac->ac_align)
+		ac->ac_g_ex.fe_len = ac->ac_align;
 	else
 		ac->ac_g_ex.fe_len = EXT4_SB(sb)->s_mb_group_prealloc;
 	mb_debug(1, "#%u: goal %u blocks for locality group\n",
@@ -3039,6 +3153,25 @@ ext4_mb_normalize_request(struct ext4_allocation_context *ac,
 static void ext4_mb_collect_stats(struct ext4_allocation_context *ac)
 {
 	struct ext4_sb_info *sbi = EXT4_SB(ac->ac_sb);
+	unsigned long align = ac->ac_align;
+	ext4_fsblk_t start;
+
+	if (sbi->s_mb_stats && ac->ac_b_ex.fe_len > 0) {
+		/*
+		 * Chunks carved from the buddy cache tell how well space is
+		 * laid out on the device; what is handed out of a
+		 * preallocation only ever follows from that.
+		 */
+		if (ac->ac_op == EXT4_MB_HISTORY_ALLOC && align) {
+			start = ext4_grp_offs_to_block(ac->ac_sb, &ac->ac_b_ex);
+			if (do_div(start, align) == 0)
+				atomic_inc(&sbi->s_bal_aligned);
+			else
+				atomic_inc(&sbi->s_bal_unaligned);
+		}
+		if (ac->ac_flags & EXT4_MB_HINT_GROUP_ALLOC)
+			atomic_inc(&sbi->s_bal_group_pa);
+	}
 
 	if (sbi->s_mb_stats && ac->ac_g_ex.fe_len > 1) {
 		atomic_inc(&sbi->s_bal_reqs);
@@ -3990,6 +4123,7 @@ ext4_mb_initialize_context(struct ext4_allocation_context *ac,
 	ac->ac_b_ex.fe_logical = ar->logical;
 	ac->ac_status = AC_STATUS_CONTINUE;
 	ac->ac_sb = sb;
+	ac->ac_align = ext4_mb_align_blocks(sbi);
 	ac->ac_inode = ar->inode;
 	ac->ac_o_ex.fe_logical = ar->logical;
 	ac->ac_o_ex.fe_group = group;
@@ -195,6 +195,7 @@ struct ext4_allocation_context {
 	struct page *ac_buddy_page;
 	struct ext4_prealloc_space *ac_pa;
 	struct ext4_locality_group *ac_lg;
+	unsigned long ac_align;	/* ext4_mb_align_blocks() at the start */
 };
 
 #define AC_STATUS_CONTINUE	1
@@ -34,6 +34,7 @@
 #include <linux/quotaops.h>
 #include <linux/buffer_head.h>
 #include <linux/bio.h>
+#include <linux/blkdev.h>
 #include "ext4.h"
 #include "ext4_jbd2.h"
 
@@ -570,6 +571,8 @@ static int htree_dirblock_to_tree(struct file *dir_file,
 {
 	struct buffer_head *bh;
 	struct ext4_dir_entry_2 *de, *top;
+	ext4_fsblk_t ra_block = 0;
+	struct blk_plug plug;
 	int err, count = 0;
 
 	dxtrace(printk(KERN_INFO "In htree dirblock_to_tree: block %lu\n",
@@ -581,6 +584,8 @@ static int htree_dirblock_to_tree(struct file *dir_file,
 	top = (struct ext4_dir_entry_2 *) ((char *) de +
 					   dir->i_sb->s_blocksize -
 					   EXT4_DIR_REC_LEN(0));
+	/* Submit the inode table readahead of the whole block at once */
+	blk_start_plug(&plug);
 	for (; de < top; de = ext4_next_entry(de, dir->i_sb->s_blocksize)) {
 		if (ext4_check_dir_entry(dir, NULL, de, bh,
 				(block<<EXT4_BLOCK_SIZE_BITS(dir->i_sb))
@@ -588,6 +593,7 @@ static int htree_dirblock_to_tree(struct file *dir_file,
 			/* On error, skip the f_pos to the next block. */
 			dir_file->f_pos = (dir_file->f_pos |
 					(dir->i_sb->s_blocksize - 1)) + 1;
+			blk_finish_plug(&plug);
 			brelse(bh);
 			return count;
 		}
@@ -600,11 +606,15 @@ static int htree_dirblock_to_tree(struct file *dir_file,
 			continue;
 		if ((err = ext4_htree_store_dirent(dir_file,
 				   hinfo->hash, hinfo->minor_hash, de)) != 0) {
+			blk_finish_plug(&plug);
 			brelse(bh);
 			return err;
 		}
+		ext4_inode_table_readahead(dir->i_sb, le32_to_cpu(de->inode),
+					   &ra_block);
 		count++;
 	}
+	blk_finish_plug(&plug);
 	brelse(bh);
 	return count;
 }
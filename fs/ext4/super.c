@@ -1122,6 +1122,8 @@ static int ext4_show_options(struct seq_file *seq, struct vfsmount *vfs)
 		seq_puts(seq, ",nomblk_io_submit");
 	if (sbi->s_stripe)
 		seq_printf(seq, ",stripe=%lu", sbi->s_stripe);
+	if (test_opt2(sb, FLASH_ALLOC))
+		seq_puts(seq, ",flash_alloc");
 	/*
 	 * journal mode get enabled in different ways
 	 * So just print the value even if we didn't specify it
@@ -1336,6 +1338,7 @@ enum {
 	Opt_inode_readahead_blks, Opt_journal_ioprio,
 	Opt_dioread_nolock, Opt_dioread_lock,
 	Opt_discard, Opt_nodiscard, Opt_init_itable, Opt_noinit_itable,
+	Opt_flash_alloc, Opt_noflash_alloc,
 };
 
 static const match_table_t tokens = {
@@ -1411,6 +1414,8 @@ static const match_table_t tokens = {
 	{Opt_init_itable, "init_itable=%u"},
 	{Opt_init_itable, "init_itable"},
 	{Opt_noinit_itable, "noinit_itable"},
+	{Opt_flash_alloc, "flash_alloc"},
+	{Opt_noflash_alloc, "noflash_alloc"},
 	{Opt_err, NULL},
 };
 
@@ -1831,6 +1836,12 @@ set_qf_format:
 				return 0;
 			sbi->s_stripe = option;
 			break;
+		case Opt_flash_alloc:
+			set_opt2(sb, FLASH_ALLOC);
+			break;
+		case Opt_noflash_alloc:
+			clear_opt2(sb, FLASH_ALLOC);
+			break;
 		case Opt_delalloc:
 			set_opt(sb, DELALLOC);
 			break;
@@ -2521,6 +2532,26 @@ static ssize_t inode_readahead_blks_store(struct ext4_attr *a,
 	return count;
 }
 
+static ssize_t mb_erase_blocks_store(struct ext4_attr *a,
+				     struct ext4_sb_info *sbi,
+				     const char *buf, size_t count)
+{
+	unsigned long t;
+
+	if (parse_strtoul(buf, sbi->s_blocks_per_group, &t))
+		return -EINVAL;
+
+	if (t == 1)
+		return -EINVAL;
+
+	/* Erase block alignment is only ever on with flash_alloc */
+	if (t && !(sbi->s_mount_opt2 & EXT4_MOUNT2_FLASH_ALLOC))
+		return -EINVAL;
+
+	sbi->s_mb_erase_blocks = t;
+	return count;
+}
+
 static ssize_t sbi_ui_show(struct ext4_attr *a,
 			   struct ext4_sb_info *sbi, char *buf)
 {
@@ -2573,6 +2604,8 @@ EXT4_RW_ATTR_SBI_UI(mb_min_to_scan, s_mb_min_to_scan);
 EXT4_RW_ATTR_SBI_UI(mb_order2_req, s_mb_order2_reqs);
 EXT4_RW_ATTR_SBI_UI(mb_stream_req, s_mb_stream_request);
 EXT4_RW_ATTR_SBI_UI(mb_group_prealloc, s_mb_group_prealloc);
+EXT4_ATTR_OFFSET(mb_erase_blocks, 0644, sbi_ui_show,
+		 mb_erase_blocks_store, s_mb_erase_blocks);
 EXT4_RW_ATTR_SBI_UI(max_writeback_mb_bump, s_max_writeback_mb_bump);
 
 static struct attribute *ext4_attrs[] = {
@@ -2589,6 +2622,7 @@ static struct attribute *ext4_attrs[] = {
 	ATTR_LIST(mb_order2_req),
 	ATTR_LIST(mb_stream_req),
 	ATTR_LIST(mb_group_prealloc),
+	ATTR_LIST(mb_erase_blocks),
 	ATTR_LIST(max_writeback_mb_bump),
 	NULL,
 };
@@ -4479,6 +4513,9 @@ static int ext4_remount(struct super_block *sb, int *flags, char *data)
 	}
 
 	ext4_setup_system_zone(sb);
+	if ((sbi->s_mount_opt2 ^ old_opts.s_mount_opt2) &
+	    EXT4_MOUNT2_FLASH_ALLOC)
+		ext4_mb_set_erase_blocks(sb);
 	if (sbi->s_journal == NULL)
 		ext4_commit_super(sb, 1);
 
@@ -20,17 +20,19 @@
 #include <linux/swap.h>
 #include <linux/splice.h>
 #include <linux/freezer.h>
+#include <linux/uaccess.h>
 
 MODULE_ALIAS_MISCDEV(FUSE_MINOR);
 MODULE_ALIAS("devname:fuse");
 
 static struct kmem_cache *fuse_req_cachep;
 
-static struct fuse_conn *fuse_get_conn(struct file *file)
+static struct fuse_dev *fuse_get_dev(struct file *file)
 {
 	/*
 	 * Lockless access is OK, because file->private data is set
-	 * once during mount and is valid until the file is released.
+	 * once during mount or clone and is valid until the file is
+	 * released.
 	 */
 	return file->private_data;
 }
@@ -209,6 +211,12 @@ void fuse_put_request(struct fuse_conn *fc, struct fuse_req *req)
 		if (req->waiting)
 			atomic_dec(&fc->num_waiting);
 
+		/* Nobody took over the lower file, e.g. open was interrupted */
+		if (req->passthrough_filp) {
+			fput(req->passthrough_filp);
+			req->passthrough_filp = NULL;
+		}
+
 		if (req->stolen_file)
 			put_reserved_req(fc, req);
 		else
@@ -238,6 +246,33 @@ static u64 fuse_get_unique(struct fuse_conn *fc)
 	return fc->reqctr;
 }
 
+/*
+ * Wake one reader for work queued on this CPU.  The pending list is
+ * shared, so any idle reader can take it; the channel this CPU maps to
+ * is preferred, and another channel is only picked if no reader of that
+ * one is idle.  A daemon thread blocked in one request then never keeps
+ * others from being served.
+ *
+ * Called with fc->lock held, on a connected fc that has at least one
+ * channel
+ */
+static void fuse_wake_reader(struct fuse_conn *fc)
+{
+	struct fuse_dev *fud = fc->dev_map[raw_smp_processor_id()];
+	struct fuse_dev *idle;
+
+	if (!waitqueue_active(&fud->waitq)) {
+		list_for_each_entry(idle, &fc->devices, entry) {
+			if (waitqueue_active(&idle->waitq)) {
+				fud = idle;
+				break;
+			}
+		}
+	}
+	/* Readers wait exclusively, so this wakes a single one */
+	wake_up(&fud->waitq);
+}
+
 static void queue_request(struct fuse_conn *fc, struct fuse_req *req)
 {
 	req->in.h.len = sizeof(struct fuse_in_header) +
@@ -248,7 +283,7 @@ static void queue_request(struct fuse_conn *fc, struct fuse_req *req)
 		req->waiting = 1;
 		atomic_inc(&fc->num_waiting);
 	}
-	wake_up(&fc->waitq);
+	fuse_wake_reader(fc);
 	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 }
 
@@ -262,7 +297,7 @@ void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 	if (fc->connected) {
 		fc->forget_list_tail->next = forget;
 		fc->forget_list_tail = forget;
-		wake_up(&fc->waitq);
+		fuse_wake_reader(fc);
 		kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 	} else {
 		kfree(forget);
@@ -338,8 +373,8 @@ __acquires(fc->lock)
 
 static void queue_interrupt(struct fuse_conn *fc, struct fuse_req *req)
 {
-	list_add_tail(&req->intr_entry, &fc->interrupts);
-	wake_up(&fc->waitq);
+	list_add_tail(&req->intr_entry, &req->fud->interrupts);
+	wake_up(&req->fud->waitq);
 	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 }
 
@@ -915,21 +950,29 @@ static int forget_pending(struct fuse_conn *fc)
 	return fc->forget_list_head.next != NULL;
 }
 
-static int request_pending(struct fuse_conn *fc)
+/*
+ * Requests and forgets are not bound to a channel, any of them may send
+ * them.  Interrupts must go out on the channel their request was read
+ * from.
+ */
+static int request_pending(struct fuse_dev *fud)
 {
-	return !list_empty(&fc->pending) || !list_empty(&fc->interrupts) ||
+	struct fuse_conn *fc = fud->fc;
+
+	return !list_empty(&fc->pending) || !list_empty(&fud->interrupts) ||
 		forget_pending(fc);
 }
 
 /* Wait until a request is available on the pending list */
-static void request_wait(struct fuse_conn *fc)
+static void request_wait(struct fuse_dev *fud)
 __releases(fc->lock)
 __acquires(fc->lock)
 {
+	struct fuse_conn *fc = fud->fc;
 	DECLARE_WAITQUEUE(wait, current);
 
-	add_wait_queue_exclusive(&fc->waitq, &wait);
-	while (fc->connected && !request_pending(fc)) {
+	add_wait_queue_exclusive(&fud->waitq, &wait);
+	while (fc->connected && !request_pending(fud)) {
 		set_current_state(TASK_INTERRUPTIBLE);
 		if (signal_pending(current))
 			break;
@@ -939,7 +982,7 @@ __acquires(fc->lock)
 		spin_lock(&fc->lock);
 	}
 	set_current_state(TASK_RUNNING);
-	remove_wait_queue(&fc->waitq, &wait);
+	remove_wait_queue(&fud->waitq, &wait);
 }
 
 /*
@@ -1103,10 +1146,11 @@ __releases(fc->lock)
  * request_end().  Otherwise add it to the processing list, and set
  * the 'sent' flag.
  */
-static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
+static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 				struct fuse_copy_state *cs, size_t nbytes)
 {
 	int err;
+	struct fuse_conn *fc = fud->fc;
 	struct fuse_req *req;
 	struct fuse_in *in;
 	unsigned reqsize;
@@ -1115,19 +1159,19 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 	spin_lock(&fc->lock);
 	err = -EAGAIN;
 	if ((file->f_flags & O_NONBLOCK) && fc->connected &&
-	    !request_pending(fc))
+	    !request_pending(fud))
 		goto err_unlock;
 
-	request_wait(fc);
+	request_wait(fud);
 	err = -ENODEV;
 	if (!fc->connected)
 		goto err_unlock;
 	err = -ERESTARTSYS;
-	if (!request_pending(fc))
+	if (!request_pending(fud))
 		goto err_unlock;
 
-	if (!list_empty(&fc->interrupts)) {
-		req = list_entry(fc->interrupts.next, struct fuse_req,
+	if (!list_empty(&fud->interrupts)) {
+		req = list_entry(fud->interrupts.next, struct fuse_req,
 				 intr_entry);
 		return fuse_read_interrupt(fc, cs, nbytes, req);
 	}
@@ -1142,7 +1186,12 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 
 	req = list_entry(fc->pending.next, struct fuse_req, list);
 	req->state = FUSE_REQ_READING;
-	list_move(&req->list, &fc->io);
+	req->fud = fud;
+	list_move(&req->list, &fud->io);
+
+	/* This reader may block in the request; let another one go on */
+	if (!list_empty(&fc->pending))
+		fuse_wake_reader(fc);
 
 	in = &req->in;
 	reqsize = in->h.len;
@@ -1177,7 +1226,7 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 		request_end(fc, req);
 	else {
 		req->state = FUSE_REQ_SENT;
-		list_move_tail(&req->list, &fc->processing);
+		list_move_tail(&req->list, &fud->processing);
 		if (req->interrupted)
 			queue_interrupt(fc, req);
 		spin_unlock(&fc->lock);
@@ -1194,13 +1243,13 @@ static ssize_t fuse_dev_read(struct kiocb *iocb, const struct iovec *iov,
 {
 	struct fuse_copy_state cs;
 	struct file *file = iocb->ki_filp;
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (!fc)
+	struct fuse_dev *fud = fuse_get_dev(file);
+	if (!fud)
 		return -EPERM;
 
-	fuse_copy_init(&cs, fc, 1, iov, nr_segs);
+	fuse_copy_init(&cs, fud->fc, 1, iov, nr_segs);
 
-	return fuse_dev_do_read(fc, file, &cs, iov_length(iov, nr_segs));
+	return fuse_dev_do_read(fud, file, &cs, iov_length(iov, nr_segs));
 }
 
 static int fuse_dev_pipe_buf_steal(struct pipe_inode_info *pipe,
@@ -1228,18 +1277,18 @@ static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
 	int do_wakeup = 0;
 	struct pipe_buffer *bufs;
 	struct fuse_copy_state cs;
-	struct fuse_conn *fc = fuse_get_conn(in);
-	if (!fc)
+	struct fuse_dev *fud = fuse_get_dev(in);
+	if (!fud)
 		return -EPERM;
 
 	bufs = kmalloc(pipe->buffers * sizeof(struct pipe_buffer), GFP_KERNEL);
 	if (!bufs)
 		return -ENOMEM;
 
-	fuse_copy_init(&cs, fc, 1, NULL, 0);
+	fuse_copy_init(&cs, fud->fc, 1, NULL, 0);
 	cs.pipebufs = bufs;
 	cs.pipe = pipe;
-	ret = fuse_dev_do_read(fc, in, &cs, len);
+	ret = fuse_dev_do_read(fud, in, &cs, len);
 	if (ret < 0)
 		goto out;
 
@@ -1608,11 +1657,11 @@ static int fuse_notify(struct fuse_conn *fc, enum fuse_notify_code code,
 }
 
 /* Look up request on processing list by unique ID */
-static struct fuse_req *request_find(struct fuse_conn *fc, u64 unique)
+static struct fuse_req *request_find(struct fuse_dev *fud, u64 unique)
 {
 	struct list_head *entry;
 
-	list_for_each(entry, &fc->processing) {
+	list_for_each(entry, &fud->processing) {
 		struct fuse_req *req;
 		req = list_entry(entry, struct fuse_req, list);
 		if (req->in.h.unique == unique || req->intr_unique == unique)
@@ -1651,10 +1700,11 @@ static int copy_out_args(struct fuse_copy_state *cs, struct fuse_out *out,
  * it from the list and copy the rest of the buffer to the request.
  * The request is finished by calling request_end()
  */
-static ssize_t fuse_dev_do_write(struct fuse_conn *fc,
+static ssize_t fuse_dev_do_write(struct fuse_dev *fud,
 				 struct fuse_copy_state *cs, size_t nbytes)
 {
 	int err;
+	struct fuse_conn *fc = fud->fc;
 	struct fuse_req *req;
 	struct fuse_out_header oh;
 
@@ -1687,7 +1737,8 @@ static ssize_t fuse_dev_do_write(struct fuse_conn *fc,
 	if (!fc->connected)
 		goto err_unlock;
 
-	req = request_find(fc, oh.unique);
+	/* Replies must come on the channel the request was read from */
+	req = request_find(fud, oh.unique);
 	if (!req)
 		goto err_unlock;
 
@@ -1715,7 +1766,7 @@ static ssize_t fuse_dev_do_write(struct fuse_conn *fc,
 	}
 
 	req->state = FUSE_REQ_WRITING;
-	list_move(&req->list, &fc->io);
+	list_move(&req->list, &fud->io);
 	req->out.h = oh;
 	req->locked = 1;
 	cs->req = req;
@@ -1726,6 +1777,10 @@ static ssize_t fuse_dev_do_write(struct fuse_conn *fc,
 	err = copy_out_args(cs, &req->out, nbytes);
 	fuse_copy_finish(cs);
 
+	/* The lower file descriptor only means something to the daemon */
+	if (!err && !req->out.h.error)
+		fuse_passthrough_setup(fc, req);
+
 	spin_lock(&fc->lock);
 	req->locked = 0;
 	if (!err) {
@@ -1748,13 +1803,13 @@ static ssize_t fuse_dev_write(struct kiocb *iocb, const struct iovec *iov,
 			      unsigned long nr_segs, loff_t pos)
 {
 	struct fuse_copy_state cs;
-	struct fuse_conn *fc = fuse_get_conn(iocb->ki_filp);
-	if (!fc)
+	struct fuse_dev *fud = fuse_get_dev(iocb->ki_filp);
+	if (!fud)
 		return -EPERM;
 
-	fuse_copy_init(&cs, fc, 0, iov, nr_segs);
+	fuse_copy_init(&cs, fud->fc, 0, iov, nr_segs);
 
-	return fuse_dev_do_write(fc, &cs, iov_length(iov, nr_segs));
+	return fuse_dev_do_write(fud, &cs, iov_length(iov, nr_segs));
 }
 
 static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
@@ -1765,12 +1820,12 @@ static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
 	unsigned idx;
 	struct pipe_buffer *bufs;
 	struct fuse_copy_state cs;
-	struct fuse_conn *fc;
+	struct fuse_dev *fud;
 	size_t rem;
 	ssize_t ret;
 
-	fc = fuse_get_conn(out);
-	if (!fc)
+	fud = fuse_get_dev(out);
+	if (!fud)
 		return -EPERM;
 
 	bufs = kmalloc(pipe->buffers * sizeof(struct pipe_buffer), GFP_KERNEL);
@@ -1817,14 +1872,14 @@ static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
 	}
 	pipe_unlock(pipe);
 
-	fuse_copy_init(&cs, fc, 0, NULL, nbuf);
+	fuse_copy_init(&cs, fud->fc, 0, NULL, nbuf);
 	cs.pipebufs = bufs;
 	cs.pipe = pipe;
 
 	if (flags & SPLICE_F_MOVE)
 		cs.move_pages = 1;
 
-	ret = fuse_dev_do_write(fc, &cs, len);
+	ret = fuse_dev_do_write(fud, &cs, len);
 
 	for (idx = 0; idx < nbuf; idx++) {
 		struct pipe_buffer *buf = &bufs[idx];
@@ -1838,16 +1893,18 @@ out:
 static unsigned fuse_dev_poll(struct file *file, poll_table *wait)
 {
 	unsigned mask = POLLOUT | POLLWRNORM;
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (!fc)
+	struct fuse_dev *fud = fuse_get_dev(file);
+	struct fuse_conn *fc;
+	if (!fud)
 		return POLLERR;
 
-	poll_wait(file, &fc->waitq, wait);
+	fc = fud->fc;
+	poll_wait(file, &fud->waitq, wait);
 
 	spin_lock(&fc->lock);
 	if (!fc->connected)
 		mask = POLLERR;
-	else if (request_pending(fc))
+	else if (request_pending(fud))
 		mask |= POLLIN | POLLRDNORM;
 	spin_unlock(&fc->lock);
 
@@ -1855,7 +1912,8 @@ static unsigned fuse_dev_poll(struct file *file, poll_table *wait)
 }
 
 /*
- * Abort all requests on the given list (pending or processing)
+ * Abort all requests on the given list (pending or processing, or
+ * several of them spliced together)
  *
  * This function releases and reacquires fc->lock
  */
@@ -1887,9 +1945,16 @@ static void end_io_requests(struct fuse_conn *fc)
 __releases(fc->lock)
 __acquires(fc->lock)
 {
-	while (!list_empty(&fc->io)) {
+	struct fuse_dev *fud;
+	LIST_HEAD(io);
+
+	/* Channels may go away while fc->lock is dropped below */
+	list_for_each_entry(fud, &fc->devices, entry)
+		list_splice_init(&fud->io, &io);
+
+	while (!list_empty(&io)) {
 		struct fuse_req *req =
-			list_entry(fc->io.next, struct fuse_req, list);
+			list_entry(io.next, struct fuse_req, list);
 		void (*end) (struct fuse_conn *, struct fuse_req *) = req->end;
 
 		req->aborted = 1;
@@ -1913,10 +1978,15 @@ static void end_queued_requests(struct fuse_conn *fc)
 __releases(fc->lock)
 __acquires(fc->lock)
 {
+	struct fuse_dev *fud;
+	LIST_HEAD(to_end);
+
 	fc->max_background = UINT_MAX;
 	flush_bg_queue(fc);
-	end_requests(fc, &fc->pending);
-	end_requests(fc, &fc->processing);
+	list_splice_tail_init(&fc->pending, &to_end);
+	list_for_each_entry(fud, &fc->devices, entry)
+		list_splice_tail_init(&fud->processing, &to_end);
+	end_requests(fc, &to_end);
 	while (forget_pending(fc))
 		kfree(dequeue_forget(fc, 1, NULL));
 }
@@ -1936,6 +2006,108 @@ static void end_polls(struct fuse_conn *fc)
 	}
 }
 
+/*
+ * Spread the CPUs over the channels of @fc, so that each channel gets
+ * the requests of about the same number of CPUs.
+ *
+ * Called with fc->lock held, with at least one channel on fc->devices
+ */
+static void fuse_map_devices(struct fuse_conn *fc)
+{
+	struct fuse_dev *fud = NULL;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		if (!fud || list_is_last(&fud->entry, &fc->devices))
+			fud = list_first_entry(&fc->devices, struct fuse_dev,
+					       entry);
+		else
+			fud = list_entry(fud->entry.next, struct fuse_dev,
+					 entry);
+		fc->dev_map[cpu] = fud;
+	}
+}
+
+/*
+ * Once the last channel is unlinked, fc->dev_map is stale, but by then
+ * the connection is no longer connected and nothing is queued anymore.
+ *
+ * Called with fc->lock held
+ */
+static void fuse_dev_unlink(struct fuse_dev *fud)
+{
+	struct fuse_conn *fc = fud->fc;
+
+	list_del(&fud->entry);
+	if (!list_empty(&fc->devices))
+		fuse_map_devices(fc);
+}
+
+struct fuse_dev *fuse_dev_alloc(struct fuse_conn *fc)
+{
+	struct fuse_dev *fud;
+	struct fuse_dev **map = NULL;
+
+	fud = kzalloc(sizeof(struct fuse_dev), GFP_KERNEL);
+	if (!fud)
+		return NULL;
+
+	/* Only the first channel of a connection allocates the map */
+	if (list_empty(&fc->devices)) {
+		map = kcalloc(nr_cpu_ids, sizeof(struct fuse_dev *),
+			      GFP_KERNEL);
+		if (!map) {
+			kfree(fud);
+			return NULL;
+		}
+	}
+
+	init_waitqueue_head(&fud->waitq);
+	INIT_LIST_HEAD(&fud->processing);
+	INIT_LIST_HEAD(&fud->io);
+	INIT_LIST_HEAD(&fud->interrupts);
+	fud->fc = fuse_conn_get(fc);
+
+	spin_lock(&fc->lock);
+	if (map) {
+		kfree(fc->dev_map);
+		fc->dev_map = map;
+	}
+	list_add_tail(&fud->entry, &fc->devices);
+	fuse_map_devices(fc);
+	spin_unlock(&fc->lock);
+
+	return fud;
+}
+EXPORT_SYMBOL_GPL(fuse_dev_alloc);
+
+void fuse_dev_free(struct fuse_dev *fud)
+{
+	struct fuse_conn *fc = fud->fc;
+
+	spin_lock(&fc->lock);
+	fuse_dev_unlink(fud);
+	spin_unlock(&fc->lock);
+	kfree(fud);
+	fuse_conn_put(fc);
+}
+EXPORT_SYMBOL_GPL(fuse_dev_free);
+
+static void __fuse_dev_wake_up_all(struct fuse_conn *fc)
+{
+	struct fuse_dev *fud;
+
+	list_for_each_entry(fud, &fc->devices, entry)
+		wake_up_all(&fud->waitq);
+}
+
+void fuse_dev_wake_up_all(struct fuse_conn *fc)
+{
+	spin_lock(&fc->lock);
+	__fuse_dev_wake_up_all(fc);
+	spin_unlock(&fc->lock);
+}
+
 /*
  * Abort all requests.
  *
@@ -1964,7 +2136,7 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		end_io_requests(fc);
 		end_queued_requests(fc);
 		end_polls(fc);
-		wake_up_all(&fc->waitq);
+		__fuse_dev_wake_up_all(fc);
 		wake_up_all(&fc->blocked_waitq);
 		kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 	}
@@ -1972,17 +2144,43 @@ void fuse_abort_conn(struct fuse_conn *fc)
 }
 EXPORT_SYMBOL_GPL(fuse_abort_conn);
 
+/*
+ * The requests that were read from a channel that is going away can only
+ * be answered through it, so they are aborted.  Pending requests are
+ * shared and stay for the other channels.
+ *
+ * Called with fc->lock held, after the channel was unlinked
+ */
+static void fuse_dev_detach(struct fuse_dev *fud)
+__releases(fc->lock)
+__acquires(fc->lock)
+{
+	WARN_ON(!list_empty(&fud->io));
+
+	end_requests(fud->fc, &fud->processing);
+}
+
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (fc) {
+	struct fuse_dev *fud = fuse_get_dev(file);
+	if (fud) {
+		struct fuse_conn *fc = fud->fc;
+
 		spin_lock(&fc->lock);
-		fc->connected = 0;
-		fc->blocked = 0;
-		end_queued_requests(fc);
-		end_polls(fc);
-		wake_up_all(&fc->blocked_waitq);
+		if (list_is_singular(&fc->devices)) {
+			/* Last channel, nobody is left to answer */
+			fc->connected = 0;
+			fc->blocked = 0;
+			end_queued_requests(fc);
+			end_polls(fc);
+			wake_up_all(&fc->blocked_waitq);
+			fuse_dev_unlink(fud);
+		} else {
+			fuse_dev_unlink(fud);
+			fuse_dev_detach(fud);
+		}
 		spin_unlock(&fc->lock);
+		kfree(fud);
 		fuse_conn_put(fc);
 	}
 
@@ -1992,12 +2190,63 @@ EXPORT_SYMBOL_GPL(fuse_dev_release);
 
 static int fuse_dev_fasync(int fd, struct file *file, int on)
 {
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (!fc)
+	struct fuse_dev *fud = fuse_get_dev(file);
+	if (!fud)
 		return -EPERM;
 
 	/* No locking - fasync_helper does its own locking */
-	return fasync_helper(fd, file, on, &fc->fasync);
+	return fasync_helper(fd, file, on, &fud->fc->fasync);
+}
+
+static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
+{
+	struct fuse_dev *fud;
+
+	if (new->private_data)
+		return -EINVAL;
+
+	fud = fuse_dev_alloc(fc);
+	if (!fud)
+		return -ENOMEM;
+
+	new->private_data = fud;
+
+	return 0;
+}
+
+static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
+			   unsigned long arg)
+{
+	struct file *old;
+	struct fuse_dev *fud;
+	u32 oldfd;
+	int err;
+
+	if (cmd != FUSE_DEV_IOC_CLONE)
+		return -ENOTTY;
+
+	if (get_user(oldfd, (u32 __user *) arg))
+		return -EFAULT;
+
+	old = fget(oldfd);
+	if (!old)
+		return -EINVAL;
+
+	/*
+	 * Only plain FUSE channels can be cloned, not CUSE ones.  The
+	 * mutex orders us against mounting with, or cloning into, the
+	 * same new file.
+	 */
+	err = -EINVAL;
+	mutex_lock(&fuse_mutex);
+	fud = fuse_get_dev(old);
+	if (old->f_op == &fuse_dev_operations &&
+	    file->f_op == &fuse_dev_operations && fud)
+		err = fuse_device_clone(fud->fc, file);
+	mutex_unlock(&fuse_mutex);
+	fput(old);
+
+	return err;
 }
 
 const struct file_operations fuse_dev_operations = {
@@ -2012,6 +2261,8 @@ const struct file_operations fuse_dev_operations = {
 	.poll		= fuse_dev_poll,
 	.release	= fuse_dev_release,
 	.fasync		= fuse_dev_fasync,
+	.unlocked_ioctl	= fuse_dev_ioctl,
+	.compat_ioctl	= fuse_dev_ioctl,
 };
 EXPORT_SYMBOL_GPL(fuse_dev_operations);
 
@@ -23,6 +23,9 @@
 #include <linux/poll.h>
 #include <linux/workqueue.h>
 
+/** Magic number of FUSE super blocks */
+#define FUSE_SUPER_MAGIC 0x65735546
+
 /** Max number of pages that can be used in a single read request */
 #define FUSE_MAX_PAGES_PER_REQ 32
 
@@ -104,6 +107,32 @@ struct fuse_inode {
 
 struct fuse_conn;
 
+/**
+ * A channel of a connection: the /dev/fuse file given at mount time, or
+ * a clone of it made with FUSE_DEV_IOC_CLONE.  Pending requests are
+ * shared by all channels; the ones read from a channel are kept on its
+ * own lists.  All protected by fuse_conn->lock.
+ */
+struct fuse_dev {
+	/** Fuse connection for this channel */
+	struct fuse_conn *fc;
+
+	/** Readers of the channel are waiting on this */
+	wait_queue_head_t waitq;
+
+	/** The list of requests being processed */
+	struct list_head processing;
+
+	/** The list of requests under I/O */
+	struct list_head io;
+
+	/** Pending interrupts */
+	struct list_head interrupts;
+
+	/** Entry on fuse_conn->devices */
+	struct list_head entry;
+};
+
 /** FUSE specific file data */
 struct fuse_file {
 	/** Fuse connection for this file */
@@ -135,6 +164,9 @@ struct fuse_file {
 
 	/** Wait queue head for poll */
 	wait_queue_head_t poll_wait;
+
+	/** Lower file that read, write and mmap are passed through to */
+	struct file *passthrough_filp;
 };
 
 /** One input argument of a request */
@@ -307,6 +339,12 @@ struct fuse_req {
 
 	/** Request is stolen from fuse_file->reserved_req */
 	struct file *stolen_file;
+
+	/** Channel the request was read from */
+	struct fuse_dev *fud;
+
+	/** Lower file for passthrough, looked up in the daemon's context */
+	struct file *passthrough_filp;
 };
 
 /**
@@ -341,17 +379,14 @@ struct fuse_conn {
 	/** Maximum write size */
 	unsigned max_write;
 
-	/** Readers of the connection are waiting on this */
-	wait_queue_head_t waitq;
+	/** Channels of the connection */
+	struct list_head devices;
 
-	/** The list of pending requests */
-	struct list_head pending;
-
-	/** The list of requests being processed */
-	struct list_head processing;
+	/** Channel whose readers are woken first for each CPU */
+	struct fuse_dev **dev_map;
 
-	/** The list of requests under I/O */
-	struct list_head io;
+	/** The list of pending requests, shared by all channels */
+	struct list_head pending;
 
 	/** The next unique kernel file handle */
 	u64 khctr;
@@ -374,9 +409,6 @@ struct fuse_conn {
 	/** The list of background requests set aside for later queuing */
 	struct list_head bg_queue;
 
-	/** Pending interrupts */
-	struct list_head interrupts;
-
 	/** Queue of pending forgets */
 	struct fuse_forget_link forget_list_head;
 	struct fuse_forget_link *forget_list_tail;
@@ -472,6 +504,12 @@ struct fuse_conn {
 	/** Don't apply umask to creation modes */
 	unsigned dont_mask:1;
 
+	/** Cache buffered writes, and write them back in batches */
+	unsigned writeback_cache:1;
+
+	/** Open may pass read, write and mmap through to a lower file */
+	unsigned passthrough:1;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -683,6 +721,16 @@ void fuse_request_send_background_locked(struct fuse_conn *fc,
 /* Abort all requests */
 void fuse_abort_conn(struct fuse_conn *fc);
 
+/**
+ * Allocate a channel of a connection, and free it when it isn't used
+ * for a mount or a clone after all
+ */
+struct fuse_dev *fuse_dev_alloc(struct fuse_conn *fc);
+void fuse_dev_free(struct fuse_dev *fud);
+
+/* Wake up the readers of all channels */
+void fuse_dev_wake_up_all(struct fuse_conn *fc);
+
 /**
  * Invalidate inode attributes
  */
@@ -763,4 +811,23 @@ int fuse_dev_release(struct inode *inode, struct file *file);
 
 void fuse_write_update_size(struct inode *inode, loff_t pos);
 
+/**
+ * Send the locally maintained mtime of a regular file to the
+ * filesystem (writeback cache mode)
+ */
+int fuse_flush_mtime(struct inode *inode);
+
+/**
+ * Passthrough of read, write and mmap to a lower file
+ */
+void fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_req *req);
+void fuse_passthrough_open(struct fuse_file *ff, fmode_t mode,
+			   struct fuse_req *req);
+void fuse_passthrough_release(struct fuse_file *ff);
+ssize_t fuse_passthrough_read(struct kiocb *iocb, const struct iovec *iov,
+			      unsigned long nr_segs, loff_t pos);
+ssize_t fuse_passthrough_write(struct kiocb *iocb, const struct iovec *iov,
+			       unsigned long nr_segs, loff_t pos);
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+
 #endif /* _FS_FUSE_I_H */
@@ -0,0 +1,209 @@
+/*
+  FUSE: Filesystem in Userspace
+
+  This program can be distributed under the terms of the GNU GPL.
+  See the file COPYING.
+*/
+
+/*
+ * Passthrough of read, write and mmap to a lower file.
+ *
+ * Many filesystems in userspace only add permission checks or a name
+ * mapping on top of a file they keep on a local filesystem, yet every
+ * read and write still makes a round trip through the daemon. Such a
+ * daemon may answer OPEN or CREATE with FOPEN_PASSTHROUGH and the file
+ * descriptor of the lower file it opened. From then on, data I/O on that
+ * open file goes straight to the lower file through the VFS; all other
+ * operations, including getattr, setattr and release, still go to the
+ * daemon.
+ */
+
+#include "fuse_i.h"
+
+#include <linux/aio.h>
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/fsnotify.h>
+#include <linux/mm.h>
+#include <linux/pagemap.h>
+#include <linux/uio.h>
+
+/*
+ * Called from fuse_dev_do_write(), in the context of the daemon, once
+ * the reply to @req has been copied. The file descriptor is only valid
+ * there, so the lower file is looked up now and kept in the request until
+ * the opener takes it over with fuse_passthrough_open().
+ */
+void fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_req *req)
+{
+	struct fuse_open_out *outarg;
+	struct file *lower;
+	struct inode *inode;
+
+	if (!fc->passthrough)
+		return;
+
+	if (req->in.h.opcode == FUSE_OPEN)
+		outarg = req->out.args[0].value;
+	else if (req->in.h.opcode == FUSE_CREATE)
+		outarg = req->out.args[1].value;
+	else
+		return;
+
+	if (!(outarg->open_flags & FOPEN_PASSTHROUGH))
+		return;
+
+	lower = fget(outarg->passthrough_fd);
+	if (!lower)
+		return;
+
+	/*
+	 * A lower file on FUSE could send requests back to this very
+	 * daemon, possibly while it waits for us.
+	 */
+	inode = lower->f_dentry->d_inode;
+	if (!S_ISREG(inode->i_mode) ||
+	    inode->i_sb->s_magic == FUSE_SUPER_MAGIC ||
+	    !lower->f_op || !lower->f_op->aio_read ||
+	    !lower->f_op->aio_write) {
+		fput(lower);
+		return;
+	}
+
+	req->passthrough_filp = lower;
+}
+
+/*
+ * Move the lower file from a successful OPEN or CREATE request to the
+ * new fuse_file. The file is opened with @mode; if the lower file does
+ * not allow the same, the open falls back to going through the daemon.
+ */
+void fuse_passthrough_open(struct fuse_file *ff, fmode_t mode,
+			   struct fuse_req *req)
+{
+	struct file *lower = req->passthrough_filp;
+
+	if (!lower)
+		return;
+
+	req->passthrough_filp = NULL;
+	mode &= FMODE_READ | FMODE_WRITE;
+	if ((lower->f_mode & mode) != mode) {
+		fput(lower);
+		return;
+	}
+	ff->passthrough_filp = lower;
+}
+
+void fuse_passthrough_release(struct fuse_file *ff)
+{
+	if (ff->passthrough_filp) {
+		fput(ff->passthrough_filp);
+		ff->passthrough_filp = NULL;
+	}
+}
+
+/*
+ * Like do_sync_readv_writev(), which is not available to modules. The
+ * caller's iocb cannot be handed down, as its ki_filp is the FUSE file.
+ */
+static ssize_t fuse_passthrough_rw(struct file *lower, int rw,
+				   const struct iovec *iov,
+				   unsigned long nr_segs, loff_t *ppos)
+{
+	size_t len = iov_length(iov, nr_segs);
+	struct kiocb kiocb;
+	ssize_t ret;
+
+	init_sync_kiocb(&kiocb, lower);
+	kiocb.ki_pos = *ppos;
+	kiocb.ki_left = len;
+	kiocb.ki_nbytes = len;
+
+	if (rw == READ)
+		ret = lower->f_op->aio_read(&kiocb, iov, nr_segs, kiocb.ki_pos);
+	else
+		ret = lower->f_op->aio_write(&kiocb, iov, nr_segs, kiocb.ki_pos);
+	if (ret == -EIOCBQUEUED)
+		ret = wait_on_sync_kiocb(&kiocb);
+	*ppos = kiocb.ki_pos;
+
+	if (ret > 0) {
+		if (rw == READ)
+			fsnotify_access(lower);
+		else
+			fsnotify_modify(lower);
+	}
+	return ret;
+}
+
+ssize_t fuse_passthrough_read(struct kiocb *iocb, const struct iovec *iov,
+			      unsigned long nr_segs, loff_t pos)
+{
+	struct fuse_file *ff = iocb->ki_filp->private_data;
+	ssize_t ret;
+
+	ret = fuse_passthrough_rw(ff->passthrough_filp, READ, iov, nr_segs,
+				  &pos);
+	if (ret > 0)
+		iocb->ki_pos = pos;
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_write(struct kiocb *iocb, const struct iovec *iov,
+			       unsigned long nr_segs, loff_t pos)
+{
+	struct file *file = iocb->ki_filp;
+	struct fuse_file *ff = file->private_data;
+	struct file *lower = ff->passthrough_filp;
+	struct inode *inode = file->f_mapping->host;
+	loff_t start;
+	ssize_t ret;
+
+	mutex_lock(&inode->i_mutex);
+	if (file->f_flags & O_APPEND)
+		pos = i_size_read(lower->f_mapping->host);
+	start = pos;
+
+	ret = fuse_passthrough_rw(lower, WRITE, iov, nr_segs, &pos);
+	if (ret > 0) {
+		iocb->ki_pos = pos;
+		fuse_write_update_size(inode, pos);
+		/* Pages cached by opens without passthrough are stale now */
+		if (file->f_mapping->nrpages)
+			invalidate_inode_pages2_range(file->f_mapping,
+					start >> PAGE_CACHE_SHIFT,
+					(pos - 1) >> PAGE_CACHE_SHIFT);
+	}
+	fuse_invalidate_attr(inode);
+	mutex_unlock(&inode->i_mutex);
+
+	return ret;
+}
+
+/*
+ * Map the lower file itself: page faults are then served by the lower
+ * filesystem, and the mapping stays valid after this file is released.
+ */
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *lower = ff->passthrough_filp;
+	int ret;
+
+	if (!lower->f_op->mmap)
+		return -ENODEV;
+
+	vma->vm_file = lower;
+	get_file(lower);
+	ret = lower->f_op->mmap(lower, vma);
+	if (ret) {
+		vma->vm_file = file;
+		fput(lower);
+	} else {
+		fput(file);
+	}
+
+	return ret;
+}
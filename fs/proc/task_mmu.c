@@ -601,6 +601,185 @@ const struct file_operations proc_clear_refs_operations = {
 	.llseek		= noop_llseek,
 };
 
+#ifdef CONFIG_PROCESS_RECLAIM
+enum reclaim_type {
+	RECLAIM_FILE,
+	RECLAIM_ANON,
+	RECLAIM_ALL,
+};
+
+/* Result of the last write, reported on read */
+struct reclaim_stats {
+	unsigned long nr_scanned;
+	unsigned long nr_reclaimed;
+};
+
+struct reclaim_param {
+	struct vm_area_struct *vma;
+	enum reclaim_type type;
+	struct reclaim_stats *stats;
+};
+
+static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
+				unsigned long end, struct mm_walk *walk)
+{
+	struct reclaim_param *rp = walk->private;
+	struct vm_area_struct *vma = rp->vma;
+	pte_t *pte, ptent;
+	spinlock_t *ptl;
+	struct page *page;
+	LIST_HEAD(page_list);
+	unsigned long nr_isolated = 0;
+
+	split_huge_page_pmd(walk->mm, pmd);
+	if (pmd_trans_unstable(pmd))
+		return 0;
+
+	pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		ptent = *pte;
+		if (!pte_present(ptent))
+			continue;
+
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page)
+			continue;
+
+		/*
+		 * Pages shared with other processes stay: paging them out
+		 * would hurt the processes that were not asked about it.
+		 */
+		if (page_mapcount(page) != 1)
+			continue;
+
+		if (rp->type == RECLAIM_ANON && !PageAnon(page))
+			continue;
+		if (rp->type == RECLAIM_FILE && PageAnon(page))
+			continue;
+
+		if (isolate_lru_page(page))
+			continue;
+
+		list_add(&page->lru, &page_list);
+		nr_isolated++;
+	}
+	pte_unmap_unlock(pte - 1, ptl);
+
+	if (nr_isolated) {
+		rp->stats->nr_scanned += nr_isolated;
+		rp->stats->nr_reclaimed += reclaim_pages_from_list(&page_list);
+	}
+	cond_resched();
+	return 0;
+}
+
+static ssize_t reclaim_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct reclaim_stats *stats = file->private_data;
+	struct task_struct *task;
+	char buffer[PROC_NUMBUF];
+	struct mm_struct *mm;
+	struct vm_area_struct *vma;
+	enum reclaim_type type;
+	char *type_buf;
+
+	memset(buffer, 0, sizeof(buffer));
+	if (count > sizeof(buffer) - 1)
+		count = sizeof(buffer) - 1;
+	if (copy_from_user(buffer, buf, count))
+		return -EFAULT;
+
+	type_buf = strstrip(buffer);
+	if (!strcmp(type_buf, "file"))
+		type = RECLAIM_FILE;
+	else if (!strcmp(type_buf, "anon"))
+		type = RECLAIM_ANON;
+	else if (!strcmp(type_buf, "all"))
+		type = RECLAIM_ALL;
+	else
+		return -EINVAL;
+
+	task = get_proc_task(file->f_path.dentry->d_inode);
+	if (!task)
+		return -ESRCH;
+
+	stats->nr_scanned = 0;
+	stats->nr_reclaimed = 0;
+
+	mm = get_task_mm(task);
+	if (mm) {
+		struct reclaim_param rp = {
+			.type = type,
+			.stats = stats,
+		};
+		struct mm_walk reclaim_walk = {
+			.pmd_entry = reclaim_pte_range,
+			.mm = mm,
+			.private = &rp,
+		};
+
+		down_read(&mm->mmap_sem);
+		for (vma = mm->mmap; vma; vma = vma->vm_next) {
+			if (is_vm_hugetlb_page(vma))
+				continue;
+			if (vma->vm_flags & VM_LOCKED)
+				continue;
+			if (type == RECLAIM_ANON && vma->vm_file)
+				continue;
+			if (type == RECLAIM_FILE && !vma->vm_file)
+				continue;
+
+			rp.vma = vma;
+			walk_page_range(vma->vm_start, vma->vm_end,
+					&reclaim_walk);
+			if (fatal_signal_pending(current))
+				break;
+		}
+		flush_tlb_mm(mm);
+		up_read(&mm->mmap_sem);
+		mmput(mm);
+	}
+	put_task_struct(task);
+
+	return count;
+}
+
+static ssize_t reclaim_read(struct file *file, char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct reclaim_stats *stats = file->private_data;
+	char buffer[64];
+	int len;
+
+	len = snprintf(buffer, sizeof(buffer), "scanned %lu\nreclaimed %lu\n",
+		       stats->nr_scanned, stats->nr_reclaimed);
+	return simple_read_from_buffer(buf, count, ppos, buffer, len);
+}
+
+static int reclaim_open(struct inode *inode, struct file *file)
+{
+	file->private_data = kzalloc(sizeof(struct reclaim_stats), GFP_KERNEL);
+	if (!file->private_data)
+		return -ENOMEM;
+	return 0;
+}
+
+static int reclaim_release(struct inode *inode, struct file *file)
+{
+	kfree(file->private_data);
+	return 0;
+}
+
+const struct file_operations proc_reclaim_operations = {
+	.open		= reclaim_open,
+	.read		= reclaim_read,
+	.write		= reclaim_write,
+	.llseek		= generic_file_llseek,
+	.release	= reclaim_release,
+};
+#endif
+
 struct pagemapread {
 	int pos, len;
 	u64 *buffer;
@@ -49,6 +49,21 @@ struct request_list {
 	wait_queue_head_t wait[2];
 };
 
+/*
+ * Writeback throttling state, protected by the queue lock.
+ * See block/blk-wbt.c.
+ */
+struct blk_wbt {
+	u64 min_lat_nsec;	/* read latency target, 0 if disabled */
+	u64 win_start;		/* start of the current window */
+	u64 win_min_lat;	/* lowest read latency in the window */
+	unsigned int win_reads;	/* reads completed in the window */
+	unsigned int win_writes; /* throttled writes completed in it */
+	unsigned int scale_step; /* depth is nr_requests >> scale_step */
+	unsigned int inflight;	/* throttled writes holding a request */
+	wait_queue_head_t wait;
+};
+
 /*
  * request command types
  */
@@ -126,6 +141,9 @@ struct request {
 #ifdef CONFIG_BLK_CGROUP
 	unsigned long long start_time_ns;
 	unsigned long long io_start_time_ns;    /* when passed to hardware */
+#endif
+#ifdef CONFIG_BLK_WBT
+	unsigned long long wbt_issue_ns;	/* read passed to hardware */
 #endif
 	/* Number of scatter-gather DMA addr+len pairs after
 	 * physical address coalescing is performed.
@@ -383,6 +401,10 @@ struct request_queue
 	/* Throttle data */
 	struct throtl_data *td;
 #endif
+
+#ifdef CONFIG_BLK_WBT
+	struct blk_wbt		wbt;
+#endif
 };
 
 #define QUEUE_FLAG_QUEUED	1	/* uses generic tag queueing */
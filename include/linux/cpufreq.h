@@ -135,6 +135,11 @@ struct cpufreq_freqs {
 	unsigned int old;
 	unsigned int new;
 	u8 flags;		/* flags of cpufreq_driver, see below. */
+	unsigned int latency_us; /* request to settled, set on POSTCHANGE */
+	u8 reason;		/* CPUFREQ_REASON_*, set on POSTCHANGE */
+	unsigned int seq;	/* with CPUFREQ_ASYNC_TARGET: the
+				 * cpufreq_request_seq() this transition
+				 * carries out */
 };
 
 
@@ -196,6 +201,10 @@ extern int cpufreq_driver_target(struct cpufreq_policy *policy,
 extern int __cpufreq_driver_target(struct cpufreq_policy *policy,
 				   unsigned int target_freq,
 				   unsigned int relation);
+extern int __cpufreq_driver_target_reason(struct cpufreq_policy *policy,
+					  unsigned int target_freq,
+					  unsigned int relation,
+					  unsigned int reason);
 
 
 extern int __cpufreq_driver_getavg(struct cpufreq_policy *policy,
@@ -214,6 +223,15 @@ void unlock_policy_rwsem_write(int cpu);
 #define CPUFREQ_RELATION_L 0  /* lowest frequency at or above target */
 #define CPUFREQ_RELATION_H 1  /* highest frequency below or at target */
 
+/* Why a frequency change was requested, see cpufreq_freqs.reason */
+#define CPUFREQ_REASON_UNKNOWN	0  /* not given by the caller */
+#define CPUFREQ_REASON_LOAD	1  /* governor load evaluation */
+#define CPUFREQ_REASON_BOOST	2  /* governor boost, e.g. on resume */
+#define CPUFREQ_REASON_INPUT	3  /* user input event */
+#define CPUFREQ_REASON_LIMIT	4  /* policy min/max changed */
+#define CPUFREQ_REASON_THERMAL	5  /* policy max changed by thermal code */
+#define CPUFREQ_REASON_NR	6
+
 struct freq_attr;
 
 struct cpufreq_driver {
@@ -254,12 +272,20 @@ struct cpufreq_driver {
 					 * frequency transitions */
 #define CPUFREQ_PM_NO_WARN	0x04	/* don't warn on suspend/resume speed
 					 * mismatches */
+#define CPUFREQ_ASYNC_TARGET	0x08	/* ->target may return before the
+					 * transition has completed; the
+					 * driver then calls
+					 * cpufreq_request_done() with the
+					 * cpufreq_request_seq() of requests
+					 * that end without a transition */
 
 int cpufreq_register_driver(struct cpufreq_driver *driver_data);
 int cpufreq_unregister_driver(struct cpufreq_driver *driver_data);
 
 
 void cpufreq_notify_transition(struct cpufreq_freqs *freqs, unsigned int state);
+unsigned int cpufreq_request_seq(unsigned int cpu);
+void cpufreq_request_done(unsigned int cpu, unsigned int seq);
 void cpufreq_notify_utilization(struct cpufreq_policy *policy,
 		unsigned int load);
 
@@ -318,6 +344,7 @@ __ATTR(_name, 0644, show_##_name, store_##_name)
  *********************************************************************/
 int cpufreq_get_policy(struct cpufreq_policy *policy, unsigned int cpu);
 int cpufreq_update_policy(unsigned int cpu);
+int cpufreq_update_policy_reason(unsigned int cpu, unsigned int reason);
 
 #ifdef CONFIG_CPU_FREQ
 /* query the current CPU frequency (in kHz). If zero, cpufreq couldn't detect it */
@@ -40,6 +40,8 @@ struct cpuidle_state {
 
 	unsigned long long	usage;
 	unsigned long long	time; /* in US */
+	unsigned long long	too_deep; /* woke before target_residency */
+	unsigned long long	too_shallow; /* a deeper state would have paid off */
 
 	int (*enter)	(struct cpuidle_device *dev,
 			 struct cpuidle_state *state);
@@ -133,6 +135,8 @@ extern void cpuidle_pause_and_lock(void);
 extern void cpuidle_resume_and_unlock(void);
 extern int cpuidle_enable_device(struct cpuidle_device *dev);
 extern void cpuidle_disable_device(struct cpuidle_device *dev);
+extern void cpuidle_report_idle_interval(unsigned int cpu,
+					 unsigned int idle_us);
 
 #else
 
@@ -149,6 +153,8 @@ static inline void cpuidle_resume_and_unlock(void) { }
 static inline int cpuidle_enable_device(struct cpuidle_device *dev)
 {return -ENODEV; }
 static inline void cpuidle_disable_device(struct cpuidle_device *dev) { }
+static inline void cpuidle_report_idle_interval(unsigned int cpu,
+						unsigned int idle_us) { }
 
 #endif
 
@@ -166,6 +172,8 @@ struct cpuidle_governor {
 
 	int  (*select)		(struct cpuidle_device *dev);
 	void (*reflect)		(struct cpuidle_device *dev);
+	void (*report)		(struct cpuidle_device *dev,
+				 unsigned int idle_us);
 
 	struct module 		*owner;
 };
@@ -27,8 +27,11 @@ void __ksm_exit(struct mm_struct *mm);
 
 static inline int ksm_fork(struct mm_struct *mm, struct mm_struct *oldmm)
 {
-	if (test_bit(MMF_VM_MERGEABLE, &oldmm->flags))
+	if (test_bit(MMF_VM_MERGEABLE, &oldmm->flags)) {
+		if (test_bit(MMF_VM_MERGE_PRIORITY, &oldmm->flags))
+			set_bit(MMF_VM_MERGE_PRIORITY, &mm->flags);
 		return __ksm_enter(mm);
+	}
 	return 0;
 }
 
@@ -171,6 +171,22 @@ enum {
 #define COUNT_CONTINUED	0x80	/* See swap_map continuation for full count */
 #define SWAP_MAP_SHMEM	0xbf	/* Owned by shmem/tmpfs, in first swap_map */
 
+/*
+ * A cluster is SWAPFILE_CLUSTER consecutive swap slots. On non-rotational
+ * devices each one counts its slots in use, and clusters with none are
+ * kept on the free_clusters list of the swap area.
+ */
+struct swap_cluster_info {
+	unsigned int count;		/* slots in use */
+	struct list_head list;		/* on free_clusters when count is 0 */
+};
+
+/* The cluster a CPU is allocating from: slots next up to end */
+struct percpu_cluster {
+	unsigned int next;
+	unsigned int end;
+};
+
 /*
  * The in-memory structure used to track swap areas.
  */
@@ -189,6 +205,13 @@ struct swap_info_struct {
 	unsigned int cluster_nr;	/* countdown to next cluster search */
 	unsigned int lowest_alloc;	/* while preparing discard cluster */
 	unsigned int highest_alloc;	/* while preparing discard cluster */
+	struct swap_cluster_info *cluster_info; /* NULL unless solid state */
+	struct list_head free_clusters;	/* clusters with no slots in use */
+	struct percpu_cluster __percpu *percpu_cluster;
+	atomic_t ra_hits;		/* readahead pages used since last swapin */
+	atomic_t ra_misses;		/* readahead pages dropped unused */
+	unsigned int ra_win;		/* last readahead window, in pages */
+	unsigned long ra_offset;	/* last swapin, for offset readahead */
 	struct swap_extent *curr_swap_extent;
 	struct swap_extent first_swap_extent;
 	struct block_device *bdev;	/* swap device or bdev of swap file */
@@ -225,6 +248,7 @@ extern void lru_add_drain(void);
 extern int lru_add_drain_all(void);
 extern void rotate_reclaimable_page(struct page *page);
 extern void deactivate_page(struct page *page);
+extern void mark_page_lazyfree(struct page *page);
 extern void swap_setup(void);
 
 extern void add_page_to_unevictable_list(struct page *page);
@@ -248,9 +272,20 @@ static inline void lru_cache_add_file(struct page *page)
 #define ISOLATE_ACTIVE 1	/* Isolate active pages. */
 #define ISOLATE_BOTH 2		/* Isolate both active and inactive pages. */
 
+/* linux/mm/workingset.c */
+extern void workingset_eviction(struct address_space *mapping,
+				struct page *page);
+extern void *workingset_take_shadow(struct address_space *mapping,
+				    pgoff_t index);
+extern bool workingset_refault(void *shadow);
+extern void workingset_activation(struct page *page);
+extern void workingset_forget_range(struct address_space *mapping,
+				    pgoff_t start, pgoff_t end);
+
 /* linux/mm/vmscan.c */
 extern unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 					gfp_t gfp_mask, nodemask_t *mask);
+extern unsigned long reclaim_pages_from_list(struct list_head *page_list);
 extern unsigned long try_to_free_mem_cgroup_pages(struct mem_cgroup *mem,
 						  gfp_t gfp_mask, bool noswap,
 						  unsigned int swappiness);
@@ -260,6 +295,8 @@ extern unsigned long mem_cgroup_shrink_node_zone(struct mem_cgroup *mem,
 						struct zone *zone,
 						unsigned long *nr_scanned);
 extern int __isolate_lru_page(struct page *page, int mode, int file);
+extern int isolate_lru_page(struct page *page);
+extern void putback_lru_page(struct page *page);
 extern unsigned long shrink_all_memory(unsigned long nr_pages);
 extern int vm_swappiness;
 extern int remove_mapping(struct address_space *mapping, struct page *page);
@@ -321,14 +358,21 @@ extern struct page *read_swap_cache_async(swp_entry_t, gfp_t,
 			struct vm_area_struct *vma, unsigned long addr);
 extern struct page *swapin_readahead(swp_entry_t, gfp_t,
 			struct vm_area_struct *vma, unsigned long addr);
+extern struct page *swap_cluster_readahead(swp_entry_t, gfp_t,
+			struct vm_area_struct *vma, unsigned long addr);
 
 /* linux/mm/swapfile.c */
 extern long nr_swap_pages;
 extern long total_swap_pages;
 extern void si_swapinfo(struct sysinfo *);
 extern swp_entry_t get_swap_page(void);
+extern int get_swap_pages(int n, swp_entry_t swp_entries[]);
+extern void swapcache_free_entries(swp_entry_t *entries, int n);
+extern bool has_usable_swap(void);
+extern int __swap_count(swp_entry_t entry);
 extern swp_entry_t get_swap_page_of_type(int);
-extern int valid_swaphandles(swp_entry_t, unsigned long *);
+extern int valid_swaphandles(swp_entry_t, unsigned long *, int);
+extern struct swap_info_struct *swp_swap_info(swp_entry_t entry);
 extern int add_swap_count_continuation(swp_entry_t, gfp_t);
 extern void swap_shmem_alloc(swp_entry_t);
 extern int swap_duplicate(swp_entry_t);
@@ -429,6 +473,13 @@ static inline struct page *swapin_readahead(swp_entry_t swp, gfp_t gfp_mask,
 	return NULL;
 }
 
+static inline struct page *swap_cluster_readahead(swp_entry_t swp,
+			gfp_t gfp_mask, struct vm_area_struct *vma,
+			unsigned long addr)
+{
+	return NULL;
+}
+
 static inline int swap_writepage(struct page *p, struct writeback_control *wbc)
 {
 	return 0;
@@ -25,6 +25,8 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		FOR_ALL_ZONES(PGALLOC),
 		PGFREE, PGACTIVATE, PGDEACTIVATE,
 		PGFAULT, PGMAJFAULT,
+		FAULT_AROUND_PAGES,	/* pages mapped around read faults */
+		FAULT_AROUND_HIT,	/* faults left with nothing to read */
 		FOR_ALL_ZONES(PGREFILL),
 		FOR_ALL_ZONES(PGSTEAL),
 		FOR_ALL_ZONES(PGSCAN_KSWAPD),
@@ -36,9 +38,21 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		KSWAPD_LOW_WMARK_HIT_QUICKLY, KSWAPD_HIGH_WMARK_HIT_QUICKLY,
 		KSWAPD_SKIP_CONGESTION_WAIT,
 		PAGEOUTRUN, ALLOCSTALL, PGROTATED,
+		PGLAZYFREE,	/* pages given up with MADV_FREE */
+		PGLAZYFREED,	/* of those, dropped by reclaim */
+#ifdef CONFIG_SWAP
+		SWAP_RA,	/* pages read ahead from swap */
+		SWAP_RA_HIT,	/* of those, faulted in while still cached */
+		SWAP_RA_MISS,	/* of those, dropped without ever being used */
+#endif
 #ifdef CONFIG_COMPACTION
 		COMPACTBLOCKS, COMPACTPAGES, COMPACTPAGEFAILED,
 		COMPACTSTALL, COMPACTFAIL, COMPACTSUCCESS,
+		COMPACTSTALL_MS,	/* time spent in direct compaction */
+		KCOMPACTD_WAKE,		/* kcompactd woken to compact a node */
+		KCOMPACTD_MIGRATED,	/* pages moved by kcompactd */
+		KCOMPACTD_SUCCESS,	/* zones kcompactd made ready */
+		KCOMPACTD_STALL_SAVED_MS, /* direct compaction time avoided */
 #endif
 #ifdef CONFIG_HUGETLB_PAGE
 		HTLB_BUDDY_PGALLOC, HTLB_BUDDY_PGALLOC_FAIL,
@@ -559,6 +559,11 @@ struct rq {
 	/* try_to_wake_up() stats */
 	unsigned int ttwu_count;
 	unsigned int ttwu_local;
+
+	/* task packing stats */
+	unsigned int ttwu_pack;
+	unsigned int ttwu_spread;
+	unsigned int lb_pack_kept;
 #endif
 
 #ifdef CONFIG_SMP
@@ -1675,6 +1675,74 @@ static int select_idle_sibling(struct task_struct *p, int target)
 	return target;
 }
 
+/*
+ * Task packing: while a CPU runs below sysctl_sched_pack_util percent of
+ * its capacity, small tasks are placed on the lowest-numbered such CPU
+ * instead of being spread, so that the other cores can stay in power
+ * collapse or be taken offline. Once every allowed CPU is above the
+ * threshold, placement falls back to the normal spreading logic.
+ * Zero disables packing.
+ */
+unsigned int sysctl_sched_pack_util;
+
+/*
+ * Utilization in percent of one nice-0 task running flat out, scaled
+ * by the cpu's power; an always-running nice-0 task reads as 100.
+ */
+static unsigned long cpu_util_pct(int cpu)
+{
+	unsigned long load = target_load(cpu, 2);
+
+	load = (load * SCHED_POWER_SCALE) / power_of(cpu);
+	return load * 100 / SCHED_LOAD_SCALE;
+}
+
+/*
+ * A task is small when its last run ended within the minimum
+ * granularity, i.e. it did a short burst of work and went back to sleep.
+ * Only meaningful for a task that has run and slept before: a new task
+ * has not run at all and would always look small.
+ */
+static inline int task_is_small(struct task_struct *p)
+{
+	return p->se.sum_exec_runtime - p->se.prev_sum_exec_runtime <
+		sysctl_sched_min_granularity;
+}
+
+static int select_packing_cpu(struct task_struct *p, int sd_flag)
+{
+	int i;
+
+	/* fork and exec know nothing of the task's size yet, spread them */
+	if (!(sd_flag & SD_BALANCE_WAKE))
+		return -1;
+	if (!sysctl_sched_pack_util || !task_is_small(p))
+		return -1;
+
+	for_each_cpu_and(i, cpu_active_mask, &p->cpus_allowed) {
+		if (cpu_util_pct(i) < sysctl_sched_pack_util) {
+			schedstat_inc(this_rq(), ttwu_pack);
+			return i;
+		}
+	}
+
+	schedstat_inc(this_rq(), ttwu_spread);
+	return -1;
+}
+
+/*
+ * An idle cpu pulling from a packed cpu that still has headroom would
+ * only undo the packing; leave it alone until it saturates.
+ */
+static inline int pack_keep_busiest(struct rq *busiest,
+				    enum cpu_idle_type idle)
+{
+	if (!sysctl_sched_pack_util || idle == CPU_NOT_IDLE)
+		return 0;
+
+	return cpu_util_pct(cpu_of(busiest)) < sysctl_sched_pack_util;
+}
+
 /*
  * sched_balance_self: balance the current task (running on cpu) in domains
  * that have the 'flag' flag set. In practice, this is SD_BALANCE_FORK and
@@ -1697,6 +1765,11 @@ select_task_rq_fair(struct task_struct *p, int sd_flag, int wake_flags)
 	int want_sd = 1;
 	int sync = wake_flags & WF_SYNC;
 
+	new_cpu = select_packing_cpu(p, sd_flag);
+	if (new_cpu >= 0)
+		return new_cpu;
+	new_cpu = cpu;
+
 	if (sd_flag & SD_BALANCE_WAKE) {
 		if (cpumask_test_cpu(cpu, &p->cpus_allowed))
 			want_affine = 1;
@@ -3366,6 +3439,11 @@ redo:
 
 	BUG_ON(busiest == this_rq);
 
+	if (pack_keep_busiest(busiest, idle)) {
+		schedstat_inc(this_rq, lb_pack_kept);
+		goto out_balanced;
+	}
+
 	schedstat_add(sd, lb_imbalance[idle], imbalance);
 
 	ld_moved = 0;
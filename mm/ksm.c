@@ -151,6 +151,12 @@ struct rmap_item {
 #define SEQNR_MASK	0x0ff	/* low bits of unstable tree seqnr */
 #define UNSTABLE_FLAG	0x100	/* is a node of the unstable tree */
 #define STABLE_FLAG	0x200	/* is listed from the stable tree */
+#define VOLATILITY_MASK	0xc00	/* log2 of full scans between checks */
+#define VOLATILITY_SHIFT 10
+#define VOLATILITY_MAX	(VOLATILITY_MASK >> VOLATILITY_SHIFT)
+
+/* Low bits of rmap_item->address kept when it leaves a tree */
+#define RMAP_ADDRESS_MASK	(PAGE_MASK | VOLATILITY_MASK)
 
 /* The stable and unstable tree heads */
 static struct rb_root root_stable_tree = RB_ROOT;
@@ -183,6 +189,11 @@ static unsigned long ksm_pages_unshared;
 /* The number of rmap_items in use: to calculate pages_volatile */
 static unsigned long ksm_rmap_items;
 
+/* The number of pages ksmd has looked at, merged, and passed over */
+static unsigned long ksm_pages_scanned;
+static unsigned long ksm_pages_merged;
+static unsigned long ksm_pages_skipped;
+
 /* Number of pages ksmd should scan in one batch */
 static unsigned int ksm_thread_pages_to_scan = 100;
 
@@ -454,7 +465,7 @@ static void remove_node_from_stable_tree(struct stable_node *stable_node)
 		else
 			ksm_pages_shared--;
 		put_anon_vma(rmap_item->anon_vma);
-		rmap_item->address &= PAGE_MASK;
+		rmap_item->address &= RMAP_ADDRESS_MASK;
 		cond_resched();
 	}
 
@@ -542,7 +553,7 @@ static void remove_rmap_item_from_tree(struct rmap_item *rmap_item)
 			ksm_pages_shared--;
 
 		put_anon_vma(rmap_item->anon_vma);
-		rmap_item->address &= PAGE_MASK;
+		rmap_item->address &= RMAP_ADDRESS_MASK;
 
 	} else if (rmap_item->address & UNSTABLE_FLAG) {
 		unsigned char age;
@@ -559,7 +570,7 @@ static void remove_rmap_item_from_tree(struct rmap_item *rmap_item)
 			rb_erase(&rmap_item->node, &root_unstable_tree);
 
 		ksm_pages_unshared--;
-		rmap_item->address &= PAGE_MASK;
+		rmap_item->address &= RMAP_ADDRESS_MASK;
 	}
 out:
 	cond_resched();		/* we're called from many long loops */
@@ -1159,6 +1170,31 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 		ksm_pages_shared++;
 }
 
+/*
+ * A page whose content keeps changing between scans is not worth the
+ * checksum: each time it is found changed, it is checked only every other
+ * full scan, then every fourth, up to every eighth; each time it is found
+ * unchanged, the interval halves again.
+ */
+static inline int rmap_item_volatility(struct rmap_item *rmap_item)
+{
+	return (rmap_item->address & VOLATILITY_MASK) >> VOLATILITY_SHIFT;
+}
+
+static inline void set_rmap_item_volatility(struct rmap_item *rmap_item,
+					    int volatility)
+{
+	rmap_item->address &= ~VOLATILITY_MASK;
+	rmap_item->address |= volatility << VOLATILITY_SHIFT;
+}
+
+static inline bool rmap_item_skip_scan(struct rmap_item *rmap_item)
+{
+	int volatility = rmap_item_volatility(rmap_item);
+
+	return ksm_scan.seqnr & ((1UL << volatility) - 1);
+}
+
 /*
  * cmp_and_merge_page - first see if page can be merged into the stable tree;
  * if not, compare checksum to previous and if it's the same, see if page can
@@ -1191,6 +1227,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			lock_page(kpage);
 			stable_tree_append(rmap_item, page_stable_node(kpage));
 			unlock_page(kpage);
+			ksm_pages_merged++;
 		}
 		put_page(kpage);
 		return;
@@ -1204,9 +1241,17 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 */
 	checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
+		int volatility = rmap_item_volatility(rmap_item);
+
+		/* A first checksum says nothing about the page changing */
+		if (rmap_item->oldchecksum && volatility < VOLATILITY_MAX)
+			set_rmap_item_volatility(rmap_item, volatility + 1);
 		rmap_item->oldchecksum = checksum;
 		return;
 	}
+	if (rmap_item_volatility(rmap_item))
+		set_rmap_item_volatility(rmap_item,
+					 rmap_item_volatility(rmap_item) - 1);
 
 	tree_rmap_item =
 		unstable_tree_search_insert(rmap_item, page, &tree_page);
@@ -1227,6 +1272,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			if (stable_node) {
 				stable_tree_append(tree_rmap_item, stable_node);
 				stable_tree_append(rmap_item, stable_node);
+				ksm_pages_merged += 2;
 			}
 			unlock_page(kpage);
 
@@ -1386,6 +1432,7 @@ next_mm:
 		spin_unlock(&ksm_mmlist_lock);
 
 		free_mm_slot(slot);
+		clear_bit(MMF_VM_MERGE_PRIORITY, &mm->flags);
 		clear_bit(MMF_VM_MERGEABLE, &mm->flags);
 		up_read(&mm->mmap_sem);
 		mmdrop(mm);
@@ -1417,8 +1464,20 @@ static void ksm_do_scan(unsigned int scan_npages)
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
 			return;
-		if (!PageKsm(page) || !in_stable_tree(rmap_item))
-			cmp_and_merge_page(page, rmap_item);
+		ksm_pages_scanned++;
+		if (!PageKsm(page) || !in_stable_tree(rmap_item)) {
+			if (rmap_item_skip_scan(rmap_item)) {
+				/*
+				 * Left in the unstable tree, it would outlive
+				 * the scan that inserted it: take it out just
+				 * as cmp_and_merge_page() would have done.
+				 */
+				remove_rmap_item_from_tree(rmap_item);
+				ksm_pages_skipped++;
+			} else {
+				cmp_and_merge_page(page, rmap_item);
+			}
+		}
 		put_page(page);
 	}
 }
@@ -1452,6 +1511,21 @@ static int ksm_scan_thread(void *nothing)
 	return 0;
 }
 
+/*
+ * Move the mm_slot of a priority mm to the head of the list, so that it is
+ * scanned first on the next full scan. The one being scanned stays put.
+ */
+static void ksm_prioritize(struct mm_struct *mm)
+{
+	struct mm_slot *mm_slot;
+
+	spin_lock(&ksm_mmlist_lock);
+	mm_slot = get_mm_slot(mm);
+	if (mm_slot && mm_slot != ksm_scan.mm_slot)
+		list_move(&mm_slot->mm_list, &ksm_mm_head.mm_list);
+	spin_unlock(&ksm_mmlist_lock);
+}
+
 int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
 		unsigned long end, int advice, unsigned long *vm_flags)
 {
@@ -1460,25 +1534,36 @@ int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
 
 	switch (advice) {
 	case MADV_MERGEABLE:
+	case MADV_MERGEABLE_PRIORITY:
 		/*
 		 * Be somewhat over-protective for now!
 		 */
-		if (*vm_flags & (VM_MERGEABLE | VM_SHARED  | VM_MAYSHARE   |
-				 VM_PFNMAP    | VM_IO      | VM_DONTEXPAND |
-				 VM_RESERVED  | VM_HUGETLB | VM_INSERTPAGE |
-				 VM_NONLINEAR | VM_MIXEDMAP | VM_SAO))
+		if (*vm_flags & (VM_SHARED    | VM_MAYSHARE | VM_PFNMAP     |
+				 VM_IO        | VM_DONTEXPAND | VM_RESERVED |
+				 VM_HUGETLB   | VM_INSERTPAGE | VM_NONLINEAR |
+				 VM_MIXEDMAP  | VM_SAO))
 			return 0;		/* just ignore the advice */
 
+		if (advice == MADV_MERGEABLE_PRIORITY)
+			set_bit(MMF_VM_MERGE_PRIORITY, &mm->flags);
+
 		if (!test_bit(MMF_VM_MERGEABLE, &mm->flags)) {
 			err = __ksm_enter(mm);
 			if (err)
 				return err;
-		}
+		} else if (advice == MADV_MERGEABLE_PRIORITY)
+			ksm_prioritize(mm);
 
 		*vm_flags |= VM_MERGEABLE;
 		break;
 
 	case MADV_UNMERGEABLE:
+		/*
+		 * Priority belongs to the whole mm: any cancellation drops
+		 * it, and whatever stays mergeable is scanned in turn.
+		 */
+		clear_bit(MMF_VM_MERGE_PRIORITY, &mm->flags);
+
 		if (!(*vm_flags & VM_MERGEABLE))
 			return 0;		/* just ignore the advice */
 
@@ -1513,8 +1598,12 @@ int __ksm_enter(struct mm_struct *mm)
 	 * Insert just behind the scanning cursor, to let the area settle
 	 * down a little; when fork is followed by immediate exec, we don't
 	 * want ksmd to waste time setting up and tearing down an rmap_list.
+	 * A priority mm goes to the head, to be scanned first next time.
 	 */
-	list_add_tail(&mm_slot->mm_list, &ksm_scan.mm_slot->mm_list);
+	if (test_bit(MMF_VM_MERGE_PRIORITY, &mm->flags))
+		list_add(&mm_slot->mm_list, &ksm_mm_head.mm_list);
+	else
+		list_add_tail(&mm_slot->mm_list, &ksm_scan.mm_slot->mm_list);
 	spin_unlock(&ksm_mmlist_lock);
 
 	set_bit(MMF_VM_MERGEABLE, &mm->flags);
@@ -1966,6 +2055,41 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t pages_scanned_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_scanned);
+}
+KSM_ATTR_RO(pages_scanned);
+
+static ssize_t pages_skipped_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_skipped);
+}
+KSM_ATTR_RO(pages_skipped);
+
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_merged);
+}
+KSM_ATTR_RO(pages_merged);
+
+static ssize_t scan_efficiency_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	unsigned long scanned = ksm_pages_scanned;
+	u64 efficiency = 0;
+
+	/* Pages merged per million pages scanned */
+	if (scanned)
+		efficiency = div64_u64((u64)ksm_pages_merged * 1000000,
+				       scanned);
+	return sprintf(buf, "%llu\n", (unsigned long long)efficiency);
+}
+KSM_ATTR_RO(scan_efficiency);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
@@ -1975,6 +2099,10 @@ static struct attribute *ksm_attrs[] = {
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&pages_scanned_attr.attr,
+	&pages_skipped_attr.attr,
+	&pages_merged_attr.attr,
+	&scan_efficiency_attr.attr,
 	NULL,
 };
 
@@ -13,6 +13,9 @@
 #include <linux/hugetlb.h>
 #include <linux/sched.h>
 #include <linux/ksm.h>
+#include <linux/swap.h>
+#include <linux/swapops.h>
+#include <asm/tlbflush.h>
 
 /*
  * Any behaviour which results in changes to the vma->vm_flags needs to
@@ -25,6 +28,7 @@ static int madvise_need_mmap_write(int behavior)
 	case MADV_REMOVE:
 	case MADV_WILLNEED:
 	case MADV_DONTNEED:
+	case MADV_FREE:
 		return 0;
 	default:
 		/* be safe, default to 1. list exceptions explicitly */
@@ -66,6 +70,7 @@ static long madvise_behavior(struct vm_area_struct * vma,
 		new_flags &= ~VM_DONTCOPY;
 		break;
 	case MADV_MERGEABLE:
+	case MADV_MERGEABLE_PRIORITY:
 	case MADV_UNMERGEABLE:
 		error = ksm_madvise(vma, start, end, behavior, &new_flags);
 		if (error)
@@ -183,6 +188,133 @@ static long madvise_dontneed(struct vm_area_struct * vma,
 	return 0;
 }
 
+static int madvise_free_pte_range(pmd_t *pmd, unsigned long addr,
+				  unsigned long end, struct mm_walk *walk)
+{
+	struct vm_area_struct *vma = walk->private;
+	struct mm_struct *mm = walk->mm;
+	unsigned long start = addr;
+	pte_t *orig_pte, *pte, ptent;
+	spinlock_t *ptl;
+	struct page *page;
+	int nr_swap = 0;
+	bool flush = false;
+
+	split_huge_page_pmd(mm, pmd);
+	if (pmd_trans_unstable(pmd))
+		return 0;
+
+	orig_pte = pte = pte_offset_map_lock(mm, pmd, addr, &ptl);
+	arch_enter_lazy_mmu_mode();
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		ptent = *pte;
+
+		if (pte_none(ptent))
+			continue;
+
+		/* A swapped out page is given up along with its swap slot */
+		if (!pte_present(ptent)) {
+			swp_entry_t entry;
+
+			if (pte_file(ptent))
+				continue;
+			entry = pte_to_swp_entry(ptent);
+			if (non_swap_entry(entry))
+				continue;
+			nr_swap--;
+			free_swap_and_cache(entry);
+			pte_clear_not_present_full(mm, addr, pte, 0);
+			continue;
+		}
+
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page || PageKsm(page))
+			continue;
+
+		/*
+		 * PG_dirty and the swap copy belong to every mapping of the
+		 * page: they are only dropped for a page mapped here alone,
+		 * and one we can lock right now. Otherwise the page is left
+		 * as it is, pte included.
+		 *
+		 * Without either, the pte is cleaned below even if the page
+		 * is mapped elsewhere too. That only gives up the contents
+		 * as seen through this mapping: reclaim drops the page only
+		 * from ptes that stayed clean, and keeps it for the others
+		 * as soon as one of them turns out to be dirty.
+		 */
+		if (PageSwapCache(page) || PageDirty(page)) {
+			if (!trylock_page(page))
+				continue;
+			if (page_mapcount(page) != 1) {
+				unlock_page(page);
+				continue;
+			}
+			if (PageSwapCache(page) && !try_to_free_swap(page)) {
+				unlock_page(page);
+				continue;
+			}
+			ClearPageDirty(page);
+			unlock_page(page);
+		}
+
+		/*
+		 * A clean, old pte tells reclaim that the page was not
+		 * written to, nor used, since it was given up.
+		 */
+		if (pte_young(ptent) || pte_dirty(ptent)) {
+			ptent = ptep_modify_prot_start(mm, addr, pte);
+			ptent = pte_mkold(pte_mkclean(ptent));
+			ptep_modify_prot_commit(mm, addr, pte, ptent);
+			flush = true;
+		}
+
+		mark_page_lazyfree(page);
+	}
+
+	if (nr_swap)
+		add_mm_counter(mm, MM_SWAPENTS, nr_swap);
+	arch_leave_lazy_mmu_mode();
+	pte_unmap_unlock(orig_pte, ptl);
+	if (flush)
+		flush_tlb_range(vma, start, end);
+	cond_resched();
+	return 0;
+}
+
+/*
+ * Application no longer needs the contents of the given range, but may
+ * reuse the memory soon, as malloc implementations do with freed chunks.
+ * MADV_DONTNEED would zap the pages now, and each reuse would fault in a
+ * fresh zeroed page. Instead, the pages are only marked clean and queued
+ * for reclaim: if memory gets short, reclaim drops them without swapping
+ * them out, and the next access sees a zeroed page. Until then, the pages
+ * stay mapped, and writing to one again simply keeps it.
+ *
+ * Only private anonymous memory can be freed this way.
+ */
+static long madvise_free(struct vm_area_struct *vma,
+			 struct vm_area_struct **prev,
+			 unsigned long start, unsigned long end)
+{
+	struct mm_walk free_walk = {
+		.pmd_entry = madvise_free_pte_range,
+		.mm = vma->vm_mm,
+		.private = vma,
+	};
+
+	*prev = vma;
+	if (vma->vm_flags & (VM_LOCKED|VM_HUGETLB|VM_PFNMAP))
+		return -EINVAL;
+	if (vma->vm_file || vma->vm_ops)
+		return -EINVAL;
+
+	/* Pages still in the pagevecs would not be moved on the LRU */
+	lru_add_drain();
+	walk_page_range(start, end, &free_walk);
+	return 0;
+}
+
 /*
  * Application wants to free up the pages and associated backing store.
  * This is effectively punching a hole into the middle of a file.
@@ -266,6 +398,14 @@ madvise_vma(struct vm_area_struct *vma, struct vm_area_struct **prev,
 		return madvise_remove(vma, prev, start, end);
 	case MADV_WILLNEED:
 		return madvise_willneed(vma, prev, start, end);
+	case MADV_FREE:
+		/*
+		 * Anonymous pages are not reclaimed without swap space to
+		 * go to, so there is no point keeping them around.
+		 */
+		if (nr_swap_pages > 0)
+			return madvise_free(vma, prev, start, end);
+		/* fall through */
 	case MADV_DONTNEED:
 		return madvise_dontneed(vma, prev, start, end);
 	default:
@@ -285,8 +425,10 @@ madvise_behavior_valid(int behavior)
 	case MADV_REMOVE:
 	case MADV_WILLNEED:
 	case MADV_DONTNEED:
+	case MADV_FREE:
 #ifdef CONFIG_KSM
 	case MADV_MERGEABLE:
+	case MADV_MERGEABLE_PRIORITY:
 	case MADV_UNMERGEABLE:
 #endif
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
@@ -322,6 +464,8 @@ madvise_behavior_valid(int behavior)
  *		some pages ahead.
  *  MADV_DONTNEED - the application is finished with the given range,
  *		so the kernel can free resources associated with it.
+ *  MADV_FREE - the application is finished with the given range, but
+ *		the kernel only frees the pages when memory is needed.
  *  MADV_REMOVE - the application wants to free up the given range of
  *		pages and associated backing store.
  *  MADV_DONTFORK - omit this area from child's address space when forking:
@@ -329,7 +473,10 @@ madvise_behavior_valid(int behavior)
  *  MADV_DOFORK - cancel MADV_DONTFORK: no longer omit this area when forking.
  *  MADV_MERGEABLE - the application recommends that KSM try to merge pages in
  *		this area with pages of identical content from other such areas.
- *  MADV_UNMERGEABLE- cancel MADV_MERGEABLE: no longer merge pages with others.
+ *  MADV_MERGEABLE_PRIORITY - as MADV_MERGEABLE, and KSM should scan this
+ *		process, and the children it forks, ahead of the others.
+ *  MADV_UNMERGEABLE- cancel MADV_MERGEABLE: no longer merge pages with others,
+ *		and drop the priority given by MADV_MERGEABLE_PRIORITY.
  *
  * return values:
  *  zero    - success
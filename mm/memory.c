@@ -57,6 +57,7 @@
 #include <linux/swapops.h>
 #include <linux/elf.h>
 #include <linux/gfp.h>
+#include <linux/debugfs.h>
 
 #include <asm/io.h>
 #include <asm/pgalloc.h>
@@ -3334,6 +3335,125 @@ unwritable_page:
 	return ret;
 }
 
+/**
+ * do_set_pte - map a page cache page for reading
+ * @vma: vma to map the page into
+ * @address: address to map the page at
+ * @page: the page, locked and uptodate
+ * @pte: empty pte to set, with its page table lock held
+ *
+ * The pte takes over the caller's reference on @page.
+ */
+void do_set_pte(struct vm_area_struct *vma, unsigned long address,
+		struct page *page, pte_t *pte)
+{
+	pte_t entry;
+
+	flush_icache_page(vma, page);
+	entry = mk_pte(page, vma->vm_page_prot);
+	inc_mm_counter_fast(vma->vm_mm, MM_FILEPAGES);
+	page_add_file_rmap(page);
+	set_pte_at(vma->vm_mm, address, pte, entry);
+
+	/* no need to invalidate: a not-present page won't be cached */
+	update_mmu_cache(vma, address, pte);
+}
+
+/*
+ * Read faults on file mappings map whatever the page cache already holds
+ * in the naturally aligned window of fault_around_bytes around the fault,
+ * sparing the minor faults on the neighbouring pages. A power of two, no
+ * larger than one page table; a single page turns fault-around off.
+ */
+static unsigned long fault_around_bytes = 65536;
+
+#ifdef CONFIG_DEBUG_FS
+static int fault_around_bytes_get(void *data, u64 *val)
+{
+	*val = fault_around_bytes;
+	return 0;
+}
+
+static int fault_around_bytes_set(void *data, u64 val)
+{
+	if (val / PAGE_SIZE > PTRS_PER_PTE)
+		return -EINVAL;
+	if (val > PAGE_SIZE)
+		fault_around_bytes = rounddown_pow_of_two(val);
+	else
+		fault_around_bytes = PAGE_SIZE;
+	return 0;
+}
+DEFINE_SIMPLE_ATTRIBUTE(fault_around_bytes_fops,
+		fault_around_bytes_get, fault_around_bytes_set, "%llu\n");
+
+static int __init fault_around_debugfs(void)
+{
+	if (!debugfs_create_file("fault_around_bytes", 0644, NULL, NULL,
+				 &fault_around_bytes_fops))
+		pr_warning("Failed to create fault_around_bytes in debugfs\n");
+	return 0;
+}
+late_initcall(fault_around_debugfs);
+#endif
+
+/*
+ * Let ->map_pages() map the cached pages around @address, within @vma
+ * and the page table of @address. Returns true if that mapped the
+ * faulting page too, so that ->fault() need not be called.
+ */
+static bool do_fault_around(struct mm_struct *mm, struct vm_area_struct *vma,
+		unsigned long address, pmd_t *pmd, pgoff_t pgoff,
+		unsigned int flags, pte_t orig_pte)
+{
+	unsigned long start_addr, nr_pages, mask;
+	pgoff_t max_pgoff;
+	struct vm_fault vmf;
+	spinlock_t *ptl;
+	pte_t *page_table, *pte;
+	bool mapped;
+	int off;
+
+	nr_pages = ACCESS_ONCE(fault_around_bytes) >> PAGE_SHIFT;
+	mask = ~(nr_pages * PAGE_SIZE - 1) & PAGE_MASK;
+
+	start_addr = max(address & mask, vma->vm_start);
+	off = ((address - start_addr) >> PAGE_SHIFT) & (PTRS_PER_PTE - 1);
+
+	/*
+	 * max_pgoff is either the end of the page table, the end of the
+	 * vma or nr_pages from pgoff, whichever comes first.
+	 */
+	max_pgoff = pgoff - off - ((start_addr >> PAGE_SHIFT) &
+				   (PTRS_PER_PTE - 1)) + PTRS_PER_PTE - 1;
+	max_pgoff = min3(max_pgoff, vma_pages(vma) + vma->vm_pgoff - 1,
+			 pgoff - off + nr_pages - 1);
+	pgoff -= off;
+
+	page_table = pte_offset_map_lock(mm, pmd, address, &ptl);
+	pte = page_table - off;
+
+	/* Skip what is mapped already: there may be nothing left to do */
+	while (!pte_none(*pte)) {
+		if (++pgoff > max_pgoff)
+			goto out;
+		start_addr += PAGE_SIZE;
+		pte++;
+	}
+
+	vmf.virtual_address = (void __user *)start_addr;
+	vmf.pte = pte;
+	vmf.pgoff = pgoff;
+	vmf.max_pgoff = max_pgoff;
+	vmf.flags = flags;
+	vmf.page = NULL;
+	vma->vm_ops->map_pages(vma, &vmf);
+out:
+	mapped = !pte_same(*page_table, orig_pte);
+	pte_unmap_unlock(page_table, ptl);
+	return mapped;
+}
+
 static int do_linear_fault(struct mm_struct *mm, struct vm_area_struct *vma,
 		unsigned long address, pte_t *page_table, pmd_t *pmd,
 		unsigned int flags, pte_t orig_pte)
@@ -3342,6 +3462,21 @@ static int do_linear_fault(struct mm_struct *mm, struct vm_area_struct *vma,
 			- vma->vm_start) >> PAGE_SHIFT) + vma->vm_pgoff;
 
 	pte_unmap(page_table);
+
+	/*
+	 * Map what is cached around a read fault first; ->fault() is only
+	 * needed if the faulting page was not among it.
+	 */
+	if (!(flags & FAULT_FLAG_WRITE) && vma->vm_ops->map_pages &&
+	    !(vma->vm_flags & VM_NONLINEAR) &&
+	    fault_around_bytes >> PAGE_SHIFT > 1) {
+		if (do_fault_around(mm, vma, address, pmd, pgoff, flags,
+				    orig_pte)) {
+			count_vm_event(FAULT_AROUND_HIT);
+			return 0;
+		}
+	}
+
 	return __do_fault(mm, vma, address, pmd, pgoff, flags, orig_pte);
 }
 
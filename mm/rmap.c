@@ -1217,6 +1217,14 @@ int try_to_unmap_one(struct page *page, struct vm_area_struct *vma,
 			dec_mm_counter(mm, MM_FILEPAGES);
 		set_pte_at(mm, address, pte,
 				swp_entry_to_pte(make_hwpoison_entry(page)));
+	} else if ((flags & TTU_LAZYFREE) && !PageDirty(page)) {
+		/*
+		 * Given up with MADV_FREE and not written to since, through
+		 * this pte or any unmapped before: nothing to keep, and the
+		 * pte is left empty.
+		 */
+		dec_mm_counter(mm, MM_ANONPAGES);
+		goto discard;
 	} else if (PageAnon(page)) {
 		swp_entry_t entry = { .val = page_private(page) };
 
@@ -1257,6 +1265,7 @@ int try_to_unmap_one(struct page *page, struct vm_area_struct *vma,
 	} else
 		dec_mm_counter(mm, MM_FILEPAGES);
 
+discard:
 	page_remove_rmap(page);
 	page_cache_release(page);
 
@@ -1180,7 +1180,7 @@ static struct page *shmem_swapin(swp_entry_t entry, gfp_t gfp,
 	pvma.vm_pgoff = idx;
 	pvma.vm_ops = NULL;
 	pvma.vm_policy = spol;
-	page = swapin_readahead(entry, gfp, &pvma, 0);
+	page = swap_cluster_readahead(entry, gfp, &pvma, 0);
 	return page;
 }
 
@@ -1210,7 +1210,7 @@ static inline void shmem_show_mpol(struct seq_file *seq, struct mempolicy *p)
 static inline struct page *shmem_swapin(swp_entry_t entry, gfp_t gfp,
 			struct shmem_inode_info *info, unsigned long idx)
 {
-	return swapin_readahead(entry, gfp, NULL, 0);
+	return swap_cluster_readahead(entry, gfp, NULL, 0);
 }
 
 static inline struct page *shmem_alloc_page(gfp_t gfp,
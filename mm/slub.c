@@ -1485,12 +1485,55 @@ static inline int lock_and_freeze_slab(struct kmem_cache_node *n,
 	return 0;
 }
 
+/*
+ * Put a frozen slab on the partial list of this cpu, where the next
+ * refill of the cpu slab finds it without taking the list_lock.
+ *
+ * Interrupts are disabled.
+ */
+static void put_cpu_partial(struct kmem_cache *s, struct kmem_cache_cpu *c,
+				struct page *page)
+{
+	page->pobjects = page->objects - page->inuse;
+	page->next = c->partial;
+	c->partial = page;
+	c->partial_objects += page->pobjects;
+}
+
+/*
+ * Take a slab off the partial list of this cpu, if there is one on the
+ * right node. The slab is returned locked and still frozen.
+ *
+ * Interrupts are disabled.
+ */
+static struct page *get_cpu_partial(struct kmem_cache *s,
+				struct kmem_cache_cpu *c, int node)
+{
+	struct page *page = c->partial;
+
+	if (!page)
+		return NULL;
+#ifdef CONFIG_NUMA
+	if (node != NUMA_NO_NODE && page_to_nid(page) != node)
+		return NULL;
+#endif
+	c->partial = page->next;
+	c->partial_objects -= page->pobjects;
+	slab_lock(page);
+	return page;
+}
+
 /*
  * Try to allocate a partial slab from a specific node.
+ *
+ * While we hold the list_lock, also move further partial slabs to the
+ * partial list of this cpu, until it holds half of cpu_partial free
+ * objects, so that the next few refills do not need the lock.
  */
-static struct page *get_partial_node(struct kmem_cache_node *n)
+static struct page *get_partial_node(struct kmem_cache *s,
+		struct kmem_cache_node *n, struct kmem_cache_cpu *c)
 {
-	struct page *page;
+	struct page *page, *page2, *first = NULL;
 
 	/*
 	 * Racy check. If we mistakenly see no partial slabs then we
@@ -1502,19 +1545,28 @@ static struct page *get_partial_node(struct kmem_cache_node *n)
 		return NULL;
 
 	spin_lock(&n->list_lock);
-	list_for_each_entry(page, &n->partial, lru)
-		if (lock_and_freeze_slab(n, page))
-			goto out;
-	page = NULL;
-out:
+	list_for_each_entry_safe(page, page2, &n->partial, lru) {
+		if (!first) {
+			if (lock_and_freeze_slab(n, page))
+				first = page;
+		} else if (lock_and_freeze_slab(n, page)) {
+			put_cpu_partial(s, c, page);
+			slab_unlock(page);
+			stat(s, CPU_PARTIAL_NODE);
+		}
+		if (first && (kmem_cache_debug(s) ||
+				c->partial_objects >= s->cpu_partial / 2))
+			break;
+	}
 	spin_unlock(&n->list_lock);
-	return page;
+	return first;
 }
 
 /*
  * Get a page from somewhere. Search in increasing NUMA distances.
  */
-static struct page *get_any_partial(struct kmem_cache *s, gfp_t flags)
+static struct page *get_any_partial(struct kmem_cache *s, gfp_t flags,
+				struct kmem_cache_cpu *c)
 {
 #ifdef CONFIG_NUMA
 	struct zonelist *zonelist;
@@ -1554,7 +1606,7 @@ static struct page *get_any_partial(struct kmem_cache *s, gfp_t flags)
 
 		if (n && cpuset_zone_allowed_hardwall(zone, flags) &&
 				n->nr_partial > s->min_partial) {
-			page = get_partial_node(n);
+			page = get_partial_node(s, n, c);
 			if (page) {
 				put_mems_allowed();
 				return page;
@@ -1569,16 +1621,17 @@ static struct page *get_any_partial(struct kmem_cache *s, gfp_t flags)
 /*
  * Get a partial page, lock it and return it.
  */
-static struct page *get_partial(struct kmem_cache *s, gfp_t flags, int node)
+static struct page *get_partial(struct kmem_cache *s, gfp_t flags, int node,
+				struct kmem_cache_cpu *c)
 {
 	struct page *page;
 	int searchnode = (node == NUMA_NO_NODE) ? numa_node_id() : node;
 
-	page = get_partial_node(get_node(s, searchnode));
+	page = get_partial_node(s, get_node(s, searchnode), c);
 	if (page || node != NUMA_NO_NODE)
 		return page;
 
-	return get_any_partial(s, flags);
+	return get_any_partial(s, flags, c);
 }
 
 /*
@@ -1736,6 +1789,24 @@ static inline void flush_slab(struct kmem_cache *s, struct kmem_cache_cpu *c)
 	deactivate_slab(s, c);
 }
 
+/*
+ * Give the partial slabs of a cpu back to the node lists.
+ *
+ * Interrupts are disabled.
+ */
+static void unfreeze_partials(struct kmem_cache *s, struct kmem_cache_cpu *c)
+{
+	struct page *page;
+
+	while ((page = c->partial)) {
+		c->partial = page->next;
+		stat(s, CPU_PARTIAL_DRAIN);
+		slab_lock(page);
+		unfreeze_slab(s, page, 1);
+	}
+	c->partial_objects = 0;
+}
+
 /*
  * Flush cpu slab.
  *
@@ -1745,8 +1816,11 @@ static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu)
 {
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
 
-	if (likely(c && c->page))
-		flush_slab(s, c);
+	if (likely(c)) {
+		if (c->page)
+			flush_slab(s, c);
+		unfreeze_partials(s, c);
+	}
 }
 
 static void flush_cpu_slab(void *d)
@@ -1912,7 +1986,15 @@ another_slab:
 	deactivate_slab(s, c);
 
 new_slab:
-	page = get_partial(s, gfpflags, node);
+	page = get_cpu_partial(s, c, node);
+	if (page) {
+		stat(s, CPU_PARTIAL_ALLOC);
+		c->node = page_to_nid(page);
+		c->page = page;
+		goto load_freelist;
+	}
+
+	page = get_partial(s, gfpflags, node, c);
 	if (page) {
 		stat(s, ALLOC_FROM_PARTIAL);
 		c->node = page_to_nid(page);
@@ -2102,6 +2184,7 @@ static void __slab_free(struct kmem_cache *s, struct page *page,
 {
 	void *prior;
 	void **object = (void *)x;
+	struct kmem_cache_cpu *c;
 	unsigned long flags;
 
 	local_irq_save(flags);
@@ -2126,9 +2209,22 @@ static void __slab_free(struct kmem_cache *s, struct page *page,
 
 	/*
 	 * Objects left in the slab. If it was not on the partial list before
-	 * then add it.
+	 * then add it: to the partial list of this cpu if it keeps one,
+	 * where it is frozen so that further frees leave it alone, and which
+	 * is drained to the node lists in one go once it holds enough.
 	 */
 	if (unlikely(!prior)) {
+		if (!kmem_cache_debug(s) && s->cpu_partial) {
+			c = this_cpu_ptr(s->cpu_slab);
+			__SetPageSlubFrozen(page);
+			put_cpu_partial(s, c, page);
+			slab_unlock(page);
+			stat(s, CPU_PARTIAL_FREE);
+			if (c->partial_objects > s->cpu_partial)
+				unfreeze_partials(s, c);
+			local_irq_restore(flags);
+			return;
+		}
 		add_partial(get_node(s, page_to_nid(page)), page, 1);
 		stat(s, FREE_ADD_PARTIAL);
 	}
@@ -2665,6 +2761,25 @@ static int kmem_cache_open(struct kmem_cache *s,
 	 * list to avoid pounding the page allocator excessively.
 	 */
 	set_min_partial(s, ilog2(s->size));
+
+	/*
+	 * The number of free objects to keep on the partial lists of each
+	 * cpu. Small objects come and go in large numbers and most benefit
+	 * from refills that do not take the list_lock; a few slabs of large
+	 * objects are all the cpus should sit on. Debugging needs every
+	 * slab to go through the node lists.
+	 */
+	if (kmem_cache_debug(s))
+		s->cpu_partial = 0;
+	else if (s->size >= PAGE_SIZE)
+		s->cpu_partial = 2;
+	else if (s->size >= 1024)
+		s->cpu_partial = 6;
+	else if (s->size >= 256)
+		s->cpu_partial = 13;
+	else
+		s->cpu_partial = 30;
+
 	s->refcount = 1;
 #ifdef CONFIG_NUMA
 	s->remote_node_defrag_ratio = 1000;
@@ -4212,6 +4327,29 @@ static ssize_t min_partial_store(struct kmem_cache *s, const char *buf,
 }
 SLAB_ATTR(min_partial);
 
+static ssize_t cpu_partial_show(struct kmem_cache *s, char *buf)
+{
+	return sprintf(buf, "%d\n", s->cpu_partial);
+}
+
+static ssize_t cpu_partial_store(struct kmem_cache *s, const char *buf,
+				 size_t length)
+{
+	unsigned long objects;
+	int err;
+
+	err = strict_strtoul(buf, 10, &objects);
+	if (err)
+		return err;
+	if (objects > INT_MAX || (objects && kmem_cache_debug(s)))
+		return -EINVAL;
+
+	s->cpu_partial = objects;
+	flush_all(s);
+	return length;
+}
+SLAB_ATTR(cpu_partial);
+
 static ssize_t ctor_show(struct kmem_cache *s, char *buf)
 {
 	if (!s->ctor)
@@ -4232,6 +4370,30 @@ static ssize_t partial_show(struct kmem_cache *s, char *buf)
 }
 SLAB_ATTR_RO(partial);
 
+static ssize_t slabs_cpu_partial_show(struct kmem_cache *s, char *buf)
+{
+	int objects = 0;
+	int cpu;
+	int len;
+
+	/* The lists change under us; the counts are good enough */
+	for_each_online_cpu(cpu)
+		objects += per_cpu_ptr(s->cpu_slab, cpu)->partial_objects;
+
+	len = sprintf(buf, "%d", objects);
+
+#ifdef CONFIG_SMP
+	for_each_online_cpu(cpu) {
+		int x = per_cpu_ptr(s->cpu_slab, cpu)->partial_objects;
+
+		if (x && len < PAGE_SIZE - 20)
+			len += sprintf(buf + len, " C%d=%d", cpu, x);
+	}
+#endif
+	return len + sprintf(buf + len, "\n");
+}
+SLAB_ATTR_RO(slabs_cpu_partial);
+
 static ssize_t cpu_slabs_show(struct kmem_cache *s, char *buf)
 {
 	return show_slab_objects(s, buf, SO_CPU);
@@ -4558,6 +4720,10 @@ STAT_ATTR(DEACTIVATE_TO_HEAD, deactivate_to_head);
 STAT_ATTR(DEACTIVATE_TO_TAIL, deactivate_to_tail);
 STAT_ATTR(DEACTIVATE_REMOTE_FREES, deactivate_remote_frees);
 STAT_ATTR(ORDER_FALLBACK, order_fallback);
+STAT_ATTR(CPU_PARTIAL_ALLOC, cpu_partial_alloc);
+STAT_ATTR(CPU_PARTIAL_FREE, cpu_partial_free);
+STAT_ATTR(CPU_PARTIAL_NODE, cpu_partial_node);
+STAT_ATTR(CPU_PARTIAL_DRAIN, cpu_partial_drain);
 #endif
 
 static struct attribute *slab_attrs[] = {
@@ -4566,10 +4732,12 @@ static struct attribute *slab_attrs[] = {
 	&objs_per_slab_attr.attr,
 	&order_attr.attr,
 	&min_partial_attr.attr,
+	&cpu_partial_attr.attr,
 	&objects_attr.attr,
 	&objects_partial_attr.attr,
 	&partial_attr.attr,
 	&cpu_slabs_attr.attr,
+	&slabs_cpu_partial_attr.attr,
 	&ctor_attr.attr,
 	&aliases_attr.attr,
 	&align_attr.attr,
@@ -4615,6 +4783,10 @@ static struct attribute *slab_attrs[] = {
 	&deactivate_to_tail_attr.attr,
 	&deactivate_remote_frees_attr.attr,
 	&order_fallback_attr.attr,
+	&cpu_partial_alloc_attr.attr,
+	&cpu_partial_free_attr.attr,
+	&cpu_partial_node_attr.attr,
+	&cpu_partial_drain_attr.attr,
 #endif
 #ifdef CONFIG_FAILSLAB
 	&failslab_attr.attr,
@@ -0,0 +1,289 @@
+/*
+ * mm/swap_slots.c - per-CPU caches of swap slots
+ *
+ * Released under the GPL, see the file COPYING for details.
+ *
+ * Allocating a swap slot takes swap_lock, and so does giving one back.
+ * When several CPUs swap out at once, as they do to zram under memory
+ * pressure, they all queue up on that lock for every single page.
+ *
+ * Each CPU therefore keeps a batch of slots allocated from the swap
+ * devices in advance, refilled SWAP_SLOTS_CACHE_SIZE at a time under a
+ * single swap_lock hold, and hands them out to get_swap_page() without
+ * touching anything shared. Slots whose last reference is dropped are
+ * collected per CPU the same way, and returned to their device in a batch.
+ *
+ * A slot in either cache stays SWAP_HAS_CACHE in the swap map, so that it
+ * cannot be allocated twice. The caches are drained and disabled while a
+ * swap device is turned off, and deactivated when swap space runs low, so
+ * that no CPU sits on slots that another one needs.
+ */
+
+#include <linux/swap_slots.h>
+#include <linux/cpu.h>
+#include <linux/init.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
+
+static DEFINE_PER_CPU(struct swap_slots_cache, swp_slots);
+static bool swap_slot_cache_active;
+bool swap_slot_cache_enabled;
+static bool swap_slot_cache_initialized;
+/* serializes activation and deactivation on low swap space */
+static DEFINE_MUTEX(swap_slots_cache_mutex);
+/* serializes enabling and disabling around swapon and swapoff */
+static DEFINE_MUTEX(swap_slots_cache_enable_mutex);
+
+#define use_swap_slot_cache (swap_slot_cache_active && swap_slot_cache_enabled)
+
+#define SLOTS_CACHE		0x1
+#define SLOTS_CACHE_RET		0x2
+
+static void drain_slots_cache_cpu(unsigned int cpu, unsigned int type)
+{
+	struct swap_slots_cache *cache = &per_cpu(swp_slots, cpu);
+
+	if ((type & SLOTS_CACHE) && cache->slots) {
+		mutex_lock(&cache->alloc_lock);
+		swapcache_free_entries(cache->slots + cache->cur, cache->nr);
+		cache->cur = 0;
+		cache->nr = 0;
+		mutex_unlock(&cache->alloc_lock);
+	}
+	if ((type & SLOTS_CACHE_RET) && cache->slots_ret) {
+		spin_lock(&cache->free_lock);
+		swapcache_free_entries(cache->slots_ret, cache->n_ret);
+		cache->n_ret = 0;
+		spin_unlock(&cache->free_lock);
+	}
+}
+
+static void __drain_swap_slots_cache(unsigned int type)
+{
+	unsigned int cpu;
+
+	/*
+	 * Offline CPUs were drained when they went down and cannot refill,
+	 * so walking the possible ones saves us from racing with hotplug.
+	 */
+	for_each_possible_cpu(cpu)
+		drain_slots_cache_cpu(cpu, type);
+}
+
+static void deactivate_swap_slots_cache(void)
+{
+	mutex_lock(&swap_slots_cache_mutex);
+	swap_slot_cache_active = false;
+	__drain_swap_slots_cache(SLOTS_CACHE | SLOTS_CACHE_RET);
+	mutex_unlock(&swap_slots_cache_mutex);
+}
+
+static void reactivate_swap_slots_cache(void)
+{
+	mutex_lock(&swap_slots_cache_mutex);
+	swap_slot_cache_active = true;
+	mutex_unlock(&swap_slots_cache_mutex);
+}
+
+/**
+ * disable_swap_slots_cache_lock - drain and disable the slots caches
+ *
+ * Called by swapoff before it looks for the slots still in use: all
+ * cached slots are given back and stay so until the cache is re-enabled
+ * with reenable_swap_slots_cache_unlock().
+ */
+void disable_swap_slots_cache_lock(void)
+{
+	mutex_lock(&swap_slots_cache_enable_mutex);
+	swap_slot_cache_enabled = false;
+	if (swap_slot_cache_initialized)
+		__drain_swap_slots_cache(SLOTS_CACHE | SLOTS_CACHE_RET);
+}
+
+static void __reenable_swap_slots_cache(void)
+{
+	swap_slot_cache_enabled = has_usable_swap();
+}
+
+void reenable_swap_slots_cache_unlock(void)
+{
+	__reenable_swap_slots_cache();
+	mutex_unlock(&swap_slots_cache_enable_mutex);
+}
+
+static bool check_cache_active(void)
+{
+	long pages;
+
+	if (!swap_slot_cache_enabled || !swap_slot_cache_initialized)
+		return false;
+
+	pages = nr_swap_pages;
+	if (!swap_slot_cache_active) {
+		if (pages > num_online_cpus() *
+		    THRESHOLD_ACTIVATE_SWAP_SLOTS_CACHE)
+			reactivate_swap_slots_cache();
+		goto out;
+	}
+
+	/* Too little swap left to let every CPU hold on to a batch */
+	if (pages < num_online_cpus() * THRESHOLD_DEACTIVATE_SWAP_SLOTS_CACHE)
+		deactivate_swap_slots_cache();
+out:
+	return swap_slot_cache_active;
+}
+
+static int alloc_swap_slot_cache(unsigned int cpu)
+{
+	struct swap_slots_cache *cache = &per_cpu(swp_slots, cpu);
+	swp_entry_t *slots, *slots_ret;
+
+	if (cache->slots)
+		return 0;
+
+	slots = kcalloc(SWAP_SLOTS_CACHE_SIZE, sizeof(swp_entry_t),
+			GFP_KERNEL);
+	slots_ret = kcalloc(SWAP_SLOTS_CACHE_SIZE, sizeof(swp_entry_t),
+			    GFP_KERNEL);
+	if (!slots || !slots_ret) {
+		kfree(slots);
+		kfree(slots_ret);
+		return -ENOMEM;
+	}
+
+	mutex_lock(&cache->alloc_lock);
+	cache->nr = 0;
+	cache->cur = 0;
+	cache->slots = slots;
+	mutex_unlock(&cache->alloc_lock);
+
+	spin_lock(&cache->free_lock);
+	cache->n_ret = 0;
+	cache->slots_ret = slots_ret;
+	spin_unlock(&cache->free_lock);
+
+	return 0;
+}
+
+/**
+ * enable_swap_slots_cache - start caching swap slots
+ *
+ * Called by swapon once a swap device is usable. The per-CPU caches are
+ * allocated on first use; swapping works without them if that fails.
+ */
+int enable_swap_slots_cache(void)
+{
+	unsigned int cpu;
+	int ret = 0;
+
+	mutex_lock(&swap_slots_cache_enable_mutex);
+	if (!swap_slot_cache_initialized) {
+		for_each_possible_cpu(cpu) {
+			ret = alloc_swap_slot_cache(cpu);
+			if (ret)
+				goto out;
+		}
+		swap_slot_cache_initialized = true;
+		swap_slot_cache_active = true;
+	}
+	__reenable_swap_slots_cache();
+out:
+	mutex_unlock(&swap_slots_cache_enable_mutex);
+	return ret;
+}
+
+/* called with cache->alloc_lock held */
+static int refill_swap_slots_cache(struct swap_slots_cache *cache)
+{
+	if (!use_swap_slot_cache || cache->nr)
+		return 0;
+
+	cache->cur = 0;
+	cache->nr = get_swap_pages(SWAP_SLOTS_CACHE_SIZE, cache->slots);
+
+	return cache->nr;
+}
+
+/**
+ * free_swap_slot - give back a swap slot that has no references left
+ * @entry: the slot, still marked SWAP_HAS_CACHE in its swap map
+ */
+void free_swap_slot(swp_entry_t entry)
+{
+	struct swap_slots_cache *cache;
+
+	cache = &per_cpu(swp_slots, raw_smp_processor_id());
+	if (use_swap_slot_cache && cache->slots_ret) {
+		spin_lock(&cache->free_lock);
+		/* The cache may have been drained while we got here */
+		if (!use_swap_slot_cache || !cache->slots_ret) {
+			spin_unlock(&cache->free_lock);
+			goto direct_free;
+		}
+		if (cache->n_ret >= SWAP_SLOTS_CACHE_SIZE) {
+			swapcache_free_entries(cache->slots_ret, cache->n_ret);
+			cache->n_ret = 0;
+		}
+		cache->slots_ret[cache->n_ret++] = entry;
+		spin_unlock(&cache->free_lock);
+		return;
+	}
+direct_free:
+	swapcache_free_entries(&entry, 1);
+}
+
+swp_entry_t get_swap_page(void)
+{
+	struct swap_slots_cache *cache;
+	swp_entry_t entry;
+
+	entry.val = 0;
+
+	/*
+	 * Use the cache of the CPU we happen to run on; if we migrate,
+	 * alloc_lock keeps us in order with whoever else uses it.
+	 */
+	cache = &per_cpu(swp_slots, raw_smp_processor_id());
+	if (check_cache_active()) {
+		mutex_lock(&cache->alloc_lock);
+		if (cache->slots) {
+repeat:
+			if (cache->nr) {
+				entry = cache->slots[cache->cur];
+				cache->slots[cache->cur++].val = 0;
+				cache->nr--;
+			} else if (refill_swap_slots_cache(cache))
+				goto repeat;
+		}
+		mutex_unlock(&cache->alloc_lock);
+		if (entry.val)
+			return entry;
+	}
+
+	get_swap_pages(1, &entry);
+	return entry;
+}
+
+static int __cpuinit swap_slots_cpu_callback(struct notifier_block *nfb,
+					     unsigned long action, void *hcpu)
+{
+	if (action == CPU_DEAD || action == CPU_DEAD_FROZEN)
+		drain_slots_cache_cpu((long)hcpu,
+				      SLOTS_CACHE | SLOTS_CACHE_RET);
+	return NOTIFY_OK;
+}
+
+static int __init swap_slots_init(void)
+{
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct swap_slots_cache *cache = &per_cpu(swp_slots, cpu);
+
+		mutex_init(&cache->alloc_lock);
+		spin_lock_init(&cache->free_lock);
+	}
+	hotcpu_notifier(swap_slots_cpu_callback, 0);
+	return 0;
+}
+subsys_initcall(swap_slots_init);
@@ -11,6 +11,7 @@
 #include <linux/gfp.h>
 #include <linux/kernel_stat.h>
 #include <linux/swap.h>
+#include <linux/swap_slots.h>
 #include <linux/swapops.h>
 #include <linux/init.h>
 #include <linux/pagemap.h>
@@ -42,6 +43,7 @@ struct address_space swapper_space = {
 	.tree_lock	= __SPIN_LOCK_UNLOCKED(swapper_space.tree_lock),
 	.a_ops		= &swap_aops,
 	.i_mmap_nonlinear = LIST_HEAD_INIT(swapper_space.i_mmap_nonlinear),
+	.shadow_list	= LIST_HEAD_INIT(swapper_space.shadow_list),
 	.backing_dev_info = &swap_backing_dev_info,
 };
 
@@ -123,11 +125,19 @@ int add_to_swap_cache(struct page *page, swp_entry_t entry, gfp_t gfp_mask)
  */
 void __delete_from_swap_cache(struct page *page)
 {
+	swp_entry_t entry = { .val = page_private(page) };
+
 	VM_BUG_ON(!PageLocked(page));
 	VM_BUG_ON(!PageSwapCache(page));
 	VM_BUG_ON(PageWriteback(page));
 
-	radix_tree_delete(&swapper_space.page_tree, page_private(page));
+	/* Read ahead, but never faulted in: the read was wasted */
+	if (TestClearPageReadahead(page)) {
+		atomic_inc(&swp_swap_info(entry)->ra_misses);
+		__count_vm_event(SWAP_RA_MISS);
+	}
+
+	radix_tree_delete(&swapper_space.page_tree, entry.val);
 	set_page_private(page, 0);
 	ClearPageSwapCache(page);
 	total_swapcache_pages--;
@@ -266,21 +276,28 @@ struct page * lookup_swap_cache(swp_entry_t entry)
 
 	page = find_get_page(&swapper_space, entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
+		if (TestClearPageReadahead(page)) {
+			atomic_inc(&swp_swap_info(entry)->ra_hits);
+			count_vm_event(SWAP_RA_HIT);
+		}
+	}
 
 	INC_CACHE_INFO(find_total);
 	return page;
 }
 
-/* 
+/*
  * Locate a page of swap in physical memory, reserving swap cache space
  * and reading the disk if it is not already cached.
  * A failure return means that either the page allocation failed or that
  * the swap entry is no longer in use.
+ * A page read for @readahead is marked so, until it is faulted in.
  */
-struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
-			struct vm_area_struct *vma, unsigned long addr)
+static struct page *__read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			bool readahead)
 {
 	struct page *found_page, *new_page = NULL;
 	int err;
@@ -295,6 +312,16 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 		if (found_page)
 			break;
 
+		/*
+		 * A slot without users may sit in a swap slots cache, marked
+		 * SWAP_HAS_CACHE with no page coming: swapcache_prepare()
+		 * would fail with -EEXIST until the cache is drained. There is
+		 * nothing to read from such a slot anyway. While swapoff has
+		 * the caches disabled, the race below is handled as before.
+		 */
+		if (swap_slot_cache_enabled && !__swap_count(entry))
+			break;
+
 		/*
 		 * Get a new page to read into from swap.
 		 */
@@ -327,9 +354,13 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 		/* May fail (-ENOMEM) if radix-tree node allocation failed. */
 		__set_page_locked(new_page);
 		SetPageSwapBacked(new_page);
+		if (readahead)
+			SetPageReadahead(new_page);
 		err = __add_to_swap_cache(new_page, entry);
 		if (likely(!err)) {
 			radix_tree_preload_end();
+			if (readahead)
+				count_vm_event(SWAP_RA);
 			/*
 			 * Initiate read into locked page and return.
 			 */
@@ -338,6 +369,7 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 			return new_page;
 		}
 		radix_tree_preload_end();
+		ClearPageReadahead(new_page);
 		ClearPageSwapBacked(new_page);
 		__clear_page_locked(new_page);
 		/*
@@ -352,8 +384,76 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 	return found_page;
 }
 
+struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	return __read_swap_cache_async(entry, gfp_mask, vma, addr, false);
+}
+
+/*
+ * Readahead windows are capped at 1 << SWAP_RA_ORDER_CEILING pages
+ * whatever page_cluster says; VMA readahead copies that many ptes on
+ * the stack.
+ */
+#ifdef CONFIG_64BIT
+#define SWAP_RA_ORDER_CEILING	5
+#else
+#define SWAP_RA_ORDER_CEILING	3
+#endif
+
+/*
+ * Size the next readahead window of a swap device, from how many of its
+ * readahead pages were faulted in (hits) and how many were dropped unused
+ * (misses) since the last swapin. @sequential tells whether this swapin
+ * continues the last one. Returns the window in pages, 1 for none.
+ */
+static unsigned int swapin_nr_pages(struct swap_info_struct *si,
+				    bool sequential)
+{
+	unsigned int hits, misses, pages, max_pages, last_ra;
+
+	max_pages = 1 << min_t(int, page_cluster, SWAP_RA_ORDER_CEILING);
+	if (max_pages <= 1)
+		return 1;
+
+	hits = atomic_xchg(&si->ra_hits, 0);
+	misses = atomic_xchg(&si->ra_misses, 0);
+
+	/*
+	 * Read ahead a little more than was used, rounded up to a power of
+	 * two. Without hits to go by, only read ahead when the faults move
+	 * sequentially, so that a window that collapsed can open up again.
+	 */
+	pages = hits + 2;
+	if (pages == 2) {
+		if (!sequential)
+			pages = 1;
+	} else {
+		unsigned int roundup = 4;
+		while (roundup < pages)
+			roundup <<= 1;
+		pages = roundup;
+	}
+
+	if (pages > max_pages)
+		pages = max_pages;
+
+	/*
+	 * Don't shrink the window too fast on a single swapin without hits,
+	 * but drop it at once when readahead pages are being thrown away
+	 * unused: each of them cost a read, or with zram a decompression,
+	 * for nothing.
+	 */
+	last_ra = misses > hits ? 0 : ACCESS_ONCE(si->ra_win) / 2;
+	if (pages < last_ra)
+		pages = last_ra;
+	si->ra_win = pages;
+
+	return pages;
+}
+
 /**
- * swapin_readahead - swap in pages in hope we need them soon
+ * swap_cluster_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
  * @gfp_mask: memory allocation flags
  * @vma: user vma this address belongs to
@@ -362,22 +462,31 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
  * Returns the struct page for entry and addr, after queueing swapin.
  *
  * Primitive swap readahead code. We simply read an aligned block of
- * (1 << page_cluster) entries in the swap area. This method is chosen
- * because it doesn't cost us any seek time.  We also make sure to queue
- * the 'original' request together with the readahead ones...
+ * entries in the swap area, as large as the readahead window of the
+ * swap device. This method is chosen because it doesn't cost us any seek
+ * time.  We also make sure to queue the 'original' request together with
+ * the readahead ones...
  *
  * This has been extended to use the NUMA policies from the mm triggering
  * the readahead.
  *
- * Caller must hold down_read on the vma->vm_mm if vma is not NULL.
+ * Used for shmem, whose swap entries are not in page tables; @vma may be
+ * a pseudo vma holding nothing but the policy.
  */
-struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
+struct page *swap_cluster_readahead(swp_entry_t entry, gfp_t gfp_mask,
 			struct vm_area_struct *vma, unsigned long addr)
 {
-	int nr_pages;
-	struct page *page;
-	unsigned long offset;
+	struct swap_info_struct *si = swp_swap_info(entry);
+	unsigned long target = swp_offset(entry);
+	unsigned long offset = target;
 	unsigned long end_offset;
+	unsigned int win;
+	int nr_pages = 0;
+	struct page *page;
+
+	win = swapin_nr_pages(si, target == si->ra_offset + 1 ||
+				  target + 1 == si->ra_offset);
+	si->ra_offset = target;
 
 	/*
 	 * Get starting offset for readaround, and number of pages to read.
@@ -386,11 +495,13 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	 * more likely that neighbouring swap pages came from the same node:
 	 * so use the same "addr" to choose the same node for each swap read.
 	 */
-	nr_pages = valid_swaphandles(entry, &offset);
+	if (win > 1)
+		nr_pages = valid_swaphandles(entry, &offset, ilog2(win));
 	for (end_offset = offset + nr_pages; offset < end_offset; offset++) {
 		/* Ok, do the async read-ahead now */
-		page = read_swap_cache_async(swp_entry(swp_type(entry), offset),
-						gfp_mask, vma, addr);
+		page = __read_swap_cache_async(swp_entry(swp_type(entry), offset),
+					       gfp_mask, vma, addr,
+					       offset != target);
 		if (!page)
 			break;
 		page_cache_release(page);
@@ -398,3 +509,106 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	lru_add_drain();	/* Push any new pages onto the LRU now */
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
+
+static pmd_t *swap_ra_pmd(struct mm_struct *mm, unsigned long addr)
+{
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+
+	pgd = pgd_offset(mm, addr);
+	if (pgd_none(*pgd) || unlikely(pgd_bad(*pgd)))
+		return NULL;
+	pud = pud_offset(pgd, addr);
+	if (pud_none(*pud) || unlikely(pud_bad(*pud)))
+		return NULL;
+	pmd = pmd_offset(pud, addr);
+	if (pmd_none(*pmd) || pmd_trans_huge(*pmd) || unlikely(pmd_bad(*pmd)))
+		return NULL;
+	return pmd;
+}
+
+/**
+ * swapin_readahead - swap in pages in hope we need them soon
+ * @entry: swap entry of this memory
+ * @gfp_mask: memory allocation flags
+ * @vma: user vma this address belongs to
+ * @addr: address of the fault
+ *
+ * Returns the struct page for entry and addr, after queueing swapin.
+ *
+ * Pages that are close in the swap area need not be close in the address
+ * space, least of all on swap devices shared by many processes. So read
+ * ahead the swap entries found in the page table around @addr instead:
+ * ahead of the fault when the faults in @vma move up, behind it when they
+ * move down, and around it otherwise. The window is that of the swap
+ * device, sized by swapin_nr_pages(); it never leaves @vma or the page
+ * table of @addr.
+ *
+ * Caller must hold down_read on the vma->vm_mm.
+ */
+struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	struct swap_info_struct *si = swp_swap_info(entry);
+	unsigned long faddr = addr & PAGE_MASK;
+	unsigned long prev, fpfn, pfn, start, end;
+	pte_t ptes[1 << SWAP_RA_ORDER_CEILING];
+	unsigned int win, left, i;
+	bool forward, backward;
+	pmd_t *pmd;
+	pte_t *pte;
+
+	prev = vma->swap_ra_addr;
+	vma->swap_ra_addr = faddr;
+	forward = faddr == prev + PAGE_SIZE;
+	backward = faddr + PAGE_SIZE == prev;
+
+	win = swapin_nr_pages(si, forward || backward);
+	if (win <= 1)
+		goto skip;
+
+	pmd = swap_ra_pmd(vma->vm_mm, faddr);
+	if (!pmd)
+		goto skip;
+
+	if (forward)
+		left = 0;
+	else if (backward)
+		left = win - 1;
+	else
+		left = (win - 1) / 2;
+
+	fpfn = PFN_DOWN(faddr);
+	start = fpfn > left ? fpfn - left : 0;
+	end = start + win;
+	start = max3(start, PFN_DOWN(vma->vm_start), PFN_DOWN(faddr & PMD_MASK));
+	end = min(end, PFN_DOWN(pmd_addr_end(faddr, vma->vm_end)));
+
+	/*
+	 * Only a hint: entries that change under us are sorted out by
+	 * read_swap_cache_async(), and the fault rechecks its own pte.
+	 */
+	pte = pte_offset_map(pmd, start << PAGE_SHIFT);
+	for (i = 0; i < end - start; i++)
+		ptes[i] = pte[i];
+	pte_unmap(pte);
+
+	for (i = 0, pfn = start; pfn < end; i++, pfn++) {
+		swp_entry_t ra_entry;
+		struct page *page;
+
+		if (pfn == fpfn || !is_swap_pte(ptes[i]))
+			continue;
+		ra_entry = pte_to_swp_entry(ptes[i]);
+		if (unlikely(non_swap_entry(ra_entry)))
+			continue;
+		page = __read_swap_cache_async(ra_entry, gfp_mask, vma,
+					       pfn << PAGE_SHIFT, true);
+		if (page)
+			page_cache_release(page);
+	}
+	lru_add_drain();	/* Push any new pages onto the LRU now */
+skip:
+	return read_swap_cache_async(entry, gfp_mask, vma, addr);
+}
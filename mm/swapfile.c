@@ -11,6 +11,7 @@
 #include <linux/slab.h>
 #include <linux/kernel_stat.h>
 #include <linux/swap.h>
+#include <linux/swap_slots.h>
 #include <linux/vmalloc.h>
 #include <linux/pagemap.h>
 #include <linux/namei.h>
@@ -180,6 +181,71 @@ static int wait_for_discard(void *word)
 #define SWAPFILE_CLUSTER	256
 #define LATENCY_LIMIT		256
 
+/*
+ * On non-rotational devices every CPU allocates from a cluster of its own,
+ * so that the pages it swaps out together stay together on the device and
+ * allocations from different CPUs do not interleave. Clusters that are
+ * entirely free are kept on a list to find a new one quickly.
+ */
+static void inc_cluster_info_page(struct swap_info_struct *si,
+				  unsigned long offset)
+{
+	struct swap_cluster_info *ci;
+
+	if (!si->cluster_info)
+		return;
+	ci = &si->cluster_info[offset / SWAPFILE_CLUSTER];
+	if (!ci->count++)
+		list_del_init(&ci->list);
+}
+
+static void dec_cluster_info_page(struct swap_info_struct *si,
+				  unsigned long offset)
+{
+	struct swap_cluster_info *ci;
+
+	if (!si->cluster_info)
+		return;
+	ci = &si->cluster_info[offset / SWAPFILE_CLUSTER];
+	VM_BUG_ON(!ci->count);
+	if (!--ci->count)
+		list_add_tail(&ci->list, &si->free_clusters);
+}
+
+/*
+ * Pick the next free slot in this CPU's cluster, or start on a new free
+ * cluster. The cluster stays on the free list until its first slot is
+ * taken, so another CPU may share it for a moment: every slot is checked
+ * again under swap_lock anyway. Falls back to the old scan once no free
+ * cluster is left.
+ */
+static void scan_swap_map_cluster(struct swap_info_struct *si,
+				  unsigned long *offset,
+				  unsigned long *scan_base)
+{
+	struct percpu_cluster *cluster = this_cpu_ptr(si->percpu_cluster);
+	struct swap_cluster_info *ci;
+
+	for (;;) {
+		while (cluster->next < cluster->end) {
+			if (!si->swap_map[cluster->next]) {
+				*scan_base = *offset = cluster->next++;
+				return;
+			}
+			cluster->next++;
+		}
+
+		if (list_empty(&si->free_clusters)) {
+			*scan_base = *offset = si->cluster_next;
+			return;
+		}
+		ci = list_first_entry(&si->free_clusters,
+				      struct swap_cluster_info, list);
+		cluster->next = (ci - si->cluster_info) * SWAPFILE_CLUSTER;
+		cluster->end = cluster->next + SWAPFILE_CLUSTER;
+	}
+}
+
 static unsigned long scan_swap_map(struct swap_info_struct *si,
 				   unsigned char usage)
 {
@@ -201,6 +267,12 @@ static unsigned long scan_swap_map(struct swap_info_struct *si,
 	 */
 
 	si->flags += SWP_SCANNING;
+
+	if (si->cluster_info) {
+		scan_swap_map_cluster(si, &offset, &scan_base);
+		goto checks;
+	}
+
 	scan_base = offset = si->cluster_next;
 
 	if (unlikely(!si->cluster_nr--)) {
@@ -313,6 +385,7 @@ checks:
 		si->highest_bit = 0;
 	}
 	si->swap_map[offset] = usage;
+	inc_cluster_info_page(si, offset);
 	si->cluster_next = offset + 1;
 	si->flags -= SWP_SCANNING;
 
@@ -409,17 +482,29 @@ no_page:
 	return 0;
 }
 
-swp_entry_t get_swap_page(void)
+/**
+ * get_swap_pages - allocate a batch of swap slots
+ * @n: number of slots wanted
+ * @swp_entries: where to store them
+ *
+ * Allocates up to @n slots under a single swap_lock hold, marked
+ * SWAP_HAS_CACHE for the swap cache. Returns the number of slots
+ * allocated.
+ */
+int get_swap_pages(int n, swp_entry_t swp_entries[])
 {
 	struct swap_info_struct *si;
 	pgoff_t offset;
 	int type, next;
 	int wrapped = 0;
+	int n_ret = 0;
 
 	spin_lock(&swap_lock);
 	if (nr_swap_pages <= 0)
 		goto noswap;
-	nr_swap_pages--;
+	if (n > nr_swap_pages)
+		n = nr_swap_pages;
+	nr_swap_pages -= n;
 
 	for (type = swap_list.next; type >= 0 && wrapped < 2; type = next) {
 		si = swap_info[type];
@@ -437,18 +522,35 @@ swp_entry_t get_swap_page(void)
 
 		swap_list.next = next;
 		/* This is called for allocating swap entry for cache */
-		offset = scan_swap_map(si, SWAP_HAS_CACHE);
-		if (offset) {
-			spin_unlock(&swap_lock);
-			return swp_entry(type, offset);
+		while (n_ret < n) {
+			offset = scan_swap_map(si, SWAP_HAS_CACHE);
+			if (!offset)
+				break;
+			swp_entries[n_ret++] = swp_entry(type, offset);
 		}
+		if (n_ret == n)
+			break;
 		next = swap_list.next;
 	}
 
-	nr_swap_pages++;
+	nr_swap_pages += n - n_ret;
 noswap:
 	spin_unlock(&swap_lock);
-	return (swp_entry_t) {0};
+	return n_ret;
+}
+
+/*
+ * Is any swap device in use? Tells the swap slots cache whether it has
+ * anything to cache.
+ */
+bool has_usable_swap(void)
+{
+	bool ret;
+
+	spin_lock(&swap_lock);
+	ret = swap_list.head >= 0;
+	spin_unlock(&swap_lock);
+	return ret;
 }
 
 /* The only caller of this function is now susupend routine */
@@ -543,28 +645,60 @@ static unsigned char swap_entry_free(struct swap_info_struct *p,
 		mem_cgroup_uncharge_swap(entry);
 
 	usage = count | has_cache;
-	p->swap_map[offset] = usage;
-
-	/* free if no reference */
-	if (!usage) {
-		struct gendisk *disk = p->bdev->bd_disk;
-		if (offset < p->lowest_bit)
-			p->lowest_bit = offset;
-		if (offset > p->highest_bit)
-			p->highest_bit = offset;
-		if (swap_list.next >= 0 &&
-		    p->prio > swap_info[swap_list.next]->prio)
-			swap_list.next = p->type;
-		nr_swap_pages++;
-		p->inuse_pages--;
-		if ((p->flags & SWP_BLKDEV) &&
-				disk->fops->swap_slot_free_notify)
-			disk->fops->swap_slot_free_notify(p->bdev, offset);
-	}
+	/*
+	 * A slot without references is kept reserved as SWAP_HAS_CACHE: the
+	 * caller hands it to free_swap_slot() once swap_lock is dropped.
+	 */
+	p->swap_map[offset] = usage ? usage : SWAP_HAS_CACHE;
 
 	return usage;
 }
 
+static void swap_entry_release(struct swap_info_struct *p,
+			       unsigned long offset)
+{
+	struct gendisk *disk = p->bdev->bd_disk;
+
+	VM_BUG_ON(p->swap_map[offset] != SWAP_HAS_CACHE);
+	p->swap_map[offset] = 0;
+	dec_cluster_info_page(p, offset);
+
+	if (offset < p->lowest_bit)
+		p->lowest_bit = offset;
+	if (offset > p->highest_bit)
+		p->highest_bit = offset;
+	if (swap_list.next >= 0 &&
+	    p->prio > swap_info[swap_list.next]->prio)
+		swap_list.next = p->type;
+	nr_swap_pages++;
+	p->inuse_pages--;
+	if ((p->flags & SWP_BLKDEV) &&
+			disk->fops->swap_slot_free_notify)
+		disk->fops->swap_slot_free_notify(p->bdev, offset);
+}
+
+/**
+ * swapcache_free_entries - give back swap slots without references
+ * @entries: slots that are reserved with just SWAP_HAS_CACHE
+ * @n: number of slots
+ *
+ * Used by the swap slots cache to return freed and unused slots to their
+ * devices in a batch, under a single swap_lock hold.
+ */
+void swapcache_free_entries(swp_entry_t *entries, int n)
+{
+	int i;
+
+	if (!n)
+		return;
+
+	spin_lock(&swap_lock);
+	for (i = 0; i < n; i++)
+		swap_entry_release(swap_info[swp_type(entries[i])],
+				   swp_offset(entries[i]));
+	spin_unlock(&swap_lock);
+}
+
 /*
  * Caller has made sure that the swapdevice corresponding to entry
  * is still around or has not been recycled.
@@ -572,11 +706,14 @@ static unsigned char swap_entry_free(struct swap_info_struct *p,
 void swap_free(swp_entry_t entry)
 {
 	struct swap_info_struct *p;
+	unsigned char usage;
 
 	p = swap_info_get(entry);
 	if (p) {
-		swap_entry_free(p, entry, 1);
+		usage = swap_entry_free(p, entry, 1);
 		spin_unlock(&swap_lock);
+		if (!usage)
+			free_swap_slot(entry);
 	}
 }
 
@@ -594,6 +731,8 @@ void swapcache_free(swp_entry_t entry, struct page *page)
 		if (page)
 			mem_cgroup_uncharge_swapcache(page, entry, count != 0);
 		spin_unlock(&swap_lock);
+		if (!count)
+			free_swap_slot(entry);
 	}
 }
 
@@ -617,6 +756,28 @@ static inline int page_swapcount(struct page *page)
 	return count;
 }
 
+/*
+ * How many users does a swap entry have, not counting the swap cache?
+ * Lets swapin tell a slot that is free, or parked in a swap slots cache,
+ * from one whose page someone else is about to bring in.
+ */
+int __swap_count(swp_entry_t entry)
+{
+	struct swap_info_struct *p;
+	unsigned long offset = swp_offset(entry);
+	unsigned long type = swp_type(entry);
+	int count = 0;
+
+	spin_lock(&swap_lock);
+	if (type < nr_swapfiles) {
+		p = swap_info[type];
+		if ((p->flags & SWP_USED) && p->swap_map && offset < p->max)
+			count = swap_count(p->swap_map[offset]);
+	}
+	spin_unlock(&swap_lock);
+	return count;
+}
+
 /*
  * We can write to an anon page without COW if there are no other references
  * to it.  And as a side-effect, free up its swap: because the old content
@@ -687,13 +848,15 @@ int free_swap_and_cache(swp_entry_t entry)
 {
 	struct swap_info_struct *p;
 	struct page *page = NULL;
+	unsigned char usage;
 
 	if (non_swap_entry(entry))
 		return 1;
 
 	p = swap_info_get(entry);
 	if (p) {
-		if (swap_entry_free(p, entry, 1) == SWAP_HAS_CACHE) {
+		usage = swap_entry_free(p, entry, 1);
+		if (usage == SWAP_HAS_CACHE) {
 			page = find_get_page(&swapper_space, entry.val);
 			if (page && !trylock_page(page)) {
 				page_cache_release(page);
@@ -701,6 +864,8 @@ int free_swap_and_cache(swp_entry_t entry)
 			}
 		}
 		spin_unlock(&swap_lock);
+		if (!usage)
+			free_swap_slot(entry);
 	}
 	if (page) {
 		/*
@@ -1550,6 +1715,8 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 {
 	struct swap_info_struct *p = NULL;
 	unsigned char *swap_map;
+	struct swap_cluster_info *cluster_info;
+	struct percpu_cluster __percpu *percpu_cluster;
 	struct file *swap_file, *victim;
 	struct address_space *mapping;
 	struct inode *inode;
@@ -1613,6 +1780,9 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 	p->flags &= ~SWP_WRITEOK;
 	spin_unlock(&swap_lock);
 
+	/* Give back the slots the per-CPU caches hold */
+	disable_swap_slots_cache_lock();
+
 	oom_score_adj = test_set_oom_score_adj(OOM_SCORE_ADJ_MAX);
 	err = try_to_unuse(type);
 	test_set_oom_score_adj(oom_score_adj);
@@ -1626,8 +1796,10 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 		 */
 		/* re-insert swap space back into swap_list */
 		enable_swap_info(p, p->prio, p->swap_map);
+		reenable_swap_slots_cache_unlock();
 		goto out_dput;
 	}
+	reenable_swap_slots_cache_unlock();
 
 	destroy_swap_extents(p);
 	if (p->flags & SWP_CONTINUED)
@@ -1650,10 +1822,16 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 	p->max = 0;
 	swap_map = p->swap_map;
 	p->swap_map = NULL;
+	cluster_info = p->cluster_info;
+	p->cluster_info = NULL;
+	percpu_cluster = p->percpu_cluster;
+	p->percpu_cluster = NULL;
 	p->flags = 0;
 	spin_unlock(&swap_lock);
 	mutex_unlock(&swapon_mutex);
 	vfree(swap_map);
+	vfree(cluster_info);
+	free_percpu(percpu_cluster);
 	/* Destroy swap account informatin */
 	swap_cgroup_swapoff(type);
 
@@ -1866,6 +2044,10 @@ static struct swap_info_struct *alloc_swap_info(void)
 	INIT_LIST_HEAD(&p->first_swap_extent.list);
 	p->flags = SWP_USED;
 	p->next = -1;
+	atomic_set(&p->ra_hits, 0);
+	atomic_set(&p->ra_misses, 0);
+	p->ra_win = 0;
+	p->ra_offset = 0;
 	spin_unlock(&swap_lock);
 
 	return p;
@@ -2012,6 +2194,47 @@ static int setup_swap_map_and_extents(struct swap_info_struct *p,
 	return nr_extents;
 }
 
+/*
+ * Non-rotational devices allocate from per-CPU clusters. Devices that take
+ * discards keep the old allocator, which discards each new cluster before
+ * use and has all CPUs wait for that.
+ */
+static int setup_swap_clusters(struct swap_info_struct *p,
+			       unsigned char *swap_map)
+{
+	unsigned long nr_clusters = DIV_ROUND_UP(p->max, SWAPFILE_CLUSTER);
+	struct swap_cluster_info *cluster_info;
+	unsigned long i;
+
+	cluster_info = vzalloc(nr_clusters * sizeof(*cluster_info));
+	if (!cluster_info)
+		return -ENOMEM;
+
+	p->percpu_cluster = alloc_percpu(struct percpu_cluster);
+	if (!p->percpu_cluster) {
+		vfree(cluster_info);
+		return -ENOMEM;
+	}
+
+	/* Slots past the end of the device never become free */
+	cluster_info[nr_clusters - 1].count =
+		nr_clusters * SWAPFILE_CLUSTER - p->max;
+	for (i = 0; i < p->max; i++) {
+		if (swap_map[i])
+			cluster_info[i / SWAPFILE_CLUSTER].count++;
+	}
+
+	INIT_LIST_HEAD(&p->free_clusters);
+	for (i = 0; i < nr_clusters; i++) {
+		INIT_LIST_HEAD(&cluster_info[i].list);
+		if (!cluster_info[i].count)
+			list_add_tail(&cluster_info[i].list, &p->free_clusters);
+	}
+	p->cluster_info = cluster_info;
+
+	return 0;
+}
+
 SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 {
 	struct swap_info_struct *p;
@@ -2116,6 +2339,12 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 			p->flags |= SWP_DISCARDABLE;
 	}
 
+	if ((p->flags & SWP_SOLIDSTATE) && !(p->flags & SWP_DISCARDABLE)) {
+		error = setup_swap_clusters(p, swap_map);
+		if (error)
+			goto bad_swap;
+	}
+
 	mutex_lock(&swapon_mutex);
 	prio = -1;
 	if (swap_flags & SWAP_FLAG_PREFER)
@@ -2134,6 +2363,8 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 	atomic_inc(&proc_poll_event);
 	wake_up_interruptible(&proc_poll_wait);
 
+	enable_swap_slots_cache();
+
 	if (S_ISREG(inode->i_mode))
 		inode->i_flags |= S_SWAPFILE;
 	error = 0;
@@ -2150,6 +2381,10 @@ bad_swap:
 	p->flags = 0;
 	spin_unlock(&swap_lock);
 	vfree(swap_map);
+	vfree(p->cluster_info);
+	p->cluster_info = NULL;
+	free_percpu(p->percpu_cluster);
+	p->percpu_cluster = NULL;
 	if (swap_file) {
 		if (inode && S_ISREG(inode->i_mode)) {
 			mutex_unlock(&inode->i_mutex);
@@ -2296,14 +2531,20 @@ int swapcache_prepare(swp_entry_t entry)
 	return __swap_duplicate(entry, SWAP_HAS_CACHE);
 }
 
+struct swap_info_struct *swp_swap_info(swp_entry_t entry)
+{
+	return swap_info[swp_type(entry)];
+}
+
 /*
  * swap_lock prevents swap_map being freed. Don't grab an extra
  * reference on the swaphandle, it doesn't matter if it becomes unused.
+ * @order is the log2 of the readahead window, at most page_cluster.
  */
-int valid_swaphandles(swp_entry_t entry, unsigned long *offset)
+int valid_swaphandles(swp_entry_t entry, unsigned long *offset, int order)
 {
 	struct swap_info_struct *si;
-	int our_page_cluster = page_cluster;
+	int our_page_cluster = order;
 	pgoff_t target, toff;
 	pgoff_t base, end;
 	int nr_pages = 0;
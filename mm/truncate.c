@@ -217,11 +217,11 @@ void truncate_inode_pages_range(struct address_space *mapping,
 	int i;
 
 	cleancache_flush_inode(mapping);
+	end = (lend >> PAGE_CACHE_SHIFT);
 	if (mapping->nrpages == 0)
-		return;
+		goto out;
 
 	BUG_ON((lend & (PAGE_CACHE_SIZE - 1)) != (PAGE_CACHE_SIZE - 1));
-	end = (lend >> PAGE_CACHE_SHIFT);
 
 	pagevec_init(&pvec, 0);
 	next = start;
@@ -295,6 +295,8 @@ void truncate_inode_pages_range(struct address_space *mapping,
 		mem_cgroup_uncharge_end();
 	}
 	cleancache_flush_inode(mapping);
+out:
+	workingset_forget_range(mapping, start, end);
 }
 EXPORT_SYMBOL(truncate_inode_pages_range);
 
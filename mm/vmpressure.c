@@ -0,0 +1,310 @@
+/*
+ * mm/vmpressure.c - memory pressure levels for memory cgroups
+ *
+ * Released under the GPL, see the file COPYING for details.
+ *
+ * Reclaim reports how many pages it scanned and how many of those it
+ * reclaimed, per memory cgroup it reclaims from (the root cgroup for
+ * global reclaim and kswapd). Once a window of pages has been scanned the
+ * ratio is turned into a pressure level:
+ *
+ *  low      - reclaim is keeping up; a good time to trim caches
+ *  medium   - reclaim is getting harder; drop what is cheap to rebuild
+ *  critical - reclaim barely frees anything and the system is about to
+ *             stall or OOM; kill something now
+ *
+ * Userspace listens with cgroup.event_control on memory.pressure_level,
+ * giving the level as argument. A listener is signalled for its level and
+ * all higher ones, in its cgroup and, with use_hierarchy, for reclaim in
+ * descendant cgroups too.
+ */
+
+#include <linux/cgroup.h>
+#include <linux/fs.h>
+#include <linux/sched.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/swap.h>
+#include <linux/eventfd.h>
+#include <linux/vmpressure.h>
+
+/*
+ * Number of scanned pages after which the level is evaluated. Averaging
+ * over a window smooths out the noise of single reclaim passes; it is a
+ * multiple of SWAP_CLUSTER_MAX so that whole reclaim batches are counted.
+ */
+static const unsigned long vmpressure_win = SWAP_CLUSTER_MAX * 16;
+
+/*
+ * Pressure, as the share of scanned pages that could not be reclaimed,
+ * at and above which the medium and critical levels are reported.
+ */
+static const unsigned int vmpressure_level_med = 60;
+static const unsigned int vmpressure_level_critical = 95;
+
+/*
+ * When reclaim priority falls this low, reclaim has gone through a large
+ * part of the LRUs without meeting its goal, which is a sign of critical
+ * pressure whatever the ratio so far: priority 3 scans 1/8 of the LRUs.
+ */
+static const int vmpressure_level_critical_prio = 3;
+
+enum vmpressure_levels {
+	VMPRESSURE_LOW = 0,
+	VMPRESSURE_MEDIUM,
+	VMPRESSURE_CRITICAL,
+	VMPRESSURE_NUM_LEVELS,
+};
+
+static const char * const vmpressure_str_levels[] = {
+	[VMPRESSURE_LOW] = "low",
+	[VMPRESSURE_MEDIUM] = "medium",
+	[VMPRESSURE_CRITICAL] = "critical",
+};
+
+struct vmpressure_event {
+	struct eventfd_ctx *efd;
+	enum vmpressure_levels level;
+	struct list_head node;
+};
+
+static struct vmpressure *work_to_vmpressure(struct work_struct *work)
+{
+	return container_of(work, struct vmpressure, work);
+}
+
+static struct vmpressure *cg_to_vmpressure(struct cgroup *cg)
+{
+	return css_to_vmpressure(cgroup_subsys_state(cg, mem_cgroup_subsys_id));
+}
+
+static enum vmpressure_levels vmpressure_level(unsigned long pressure)
+{
+	if (pressure >= vmpressure_level_critical)
+		return VMPRESSURE_CRITICAL;
+	else if (pressure >= vmpressure_level_med)
+		return VMPRESSURE_MEDIUM;
+	return VMPRESSURE_LOW;
+}
+
+static enum vmpressure_levels vmpressure_calc_level(unsigned long scanned,
+						    unsigned long reclaimed)
+{
+	unsigned long pressure = 0;
+
+	/*
+	 * Reclaimed can exceed scanned when pages freed by other means are
+	 * counted in; such a window shows no pressure at all.
+	 */
+	if (reclaimed < scanned)
+		pressure = (scanned - reclaimed) * 100 / scanned;
+
+	pr_debug("%s: %3lu  (s: %lu  r: %lu)\n", __func__, pressure,
+		 scanned, reclaimed);
+
+	return vmpressure_level(pressure);
+}
+
+static bool vmpressure_event(struct vmpressure *vmpr,
+			     unsigned long scanned, unsigned long reclaimed)
+{
+	struct vmpressure_event *ev;
+	enum vmpressure_levels level;
+	bool signalled = false;
+
+	level = vmpressure_calc_level(scanned, reclaimed);
+
+	mutex_lock(&vmpr->events_lock);
+
+	list_for_each_entry(ev, &vmpr->events, node) {
+		if (level >= ev->level) {
+			eventfd_signal(ev->efd, 1);
+			signalled = true;
+		}
+	}
+
+	mutex_unlock(&vmpr->events_lock);
+
+	return signalled;
+}
+
+static void vmpressure_work_fn(struct work_struct *work)
+{
+	struct vmpressure *vmpr = work_to_vmpressure(work);
+	unsigned long scanned;
+	unsigned long reclaimed;
+
+	spin_lock(&vmpr->sr_lock);
+	/*
+	 * Several reclaimers may have queued us; the first run takes the
+	 * whole window and later ones find nothing to do.
+	 */
+	scanned = vmpr->scanned;
+	if (!scanned) {
+		spin_unlock(&vmpr->sr_lock);
+		return;
+	}
+
+	reclaimed = vmpr->reclaimed;
+	vmpr->scanned = 0;
+	vmpr->reclaimed = 0;
+	spin_unlock(&vmpr->sr_lock);
+
+	do {
+		if (vmpressure_event(vmpr, scanned, reclaimed))
+			break;
+		/*
+		 * Nobody listens here: pass the event up, as reclaim in a
+		 * child with use_hierarchy is pressure on the parent too.
+		 */
+	} while ((vmpr = vmpressure_parent(vmpr)));
+}
+
+/**
+ * vmpressure() - account memory pressure through scanned/reclaimed ratio
+ * @gfp:	reclaimer's gfp mask
+ * @mem:	cgroup memory controller handle, NULL for global reclaim
+ * @scanned:	number of pages scanned
+ * @reclaimed:	number of pages reclaimed
+ *
+ * Called from reclaim after each pass over a zone. Once vmpressure_win
+ * pages have been scanned in @mem, the level is evaluated and listeners
+ * are signalled from a work item.
+ */
+void vmpressure(gfp_t gfp, struct mem_cgroup *mem,
+		unsigned long scanned, unsigned long reclaimed)
+{
+	struct vmpressure *vmpr = memcg_to_vmpressure(mem);
+
+	if (!vmpr)
+		return;
+
+	/*
+	 * Only allocations that can be satisfied from any page and may do
+	 * IO tell us about the state of the LRUs: a failing GFP_NOIO or
+	 * DMA-zone allocation says nothing about overall memory.
+	 */
+	if (!(gfp & (__GFP_HIGHMEM | __GFP_MOVABLE | __GFP_IO | __GFP_FS)))
+		return;
+
+	/*
+	 * A pass that scanned nothing says nothing either: counting its
+	 * reclaimed pages alone would make the window look better than it is.
+	 */
+	if (!scanned)
+		return;
+
+	spin_lock(&vmpr->sr_lock);
+	vmpr->scanned += scanned;
+	vmpr->reclaimed += reclaimed;
+	scanned = vmpr->scanned;
+	spin_unlock(&vmpr->sr_lock);
+
+	if (scanned < vmpressure_win)
+		return;
+	schedule_work(&vmpr->work);
+}
+
+/**
+ * vmpressure_prio() - account memory pressure through reclaim priority
+ * @gfp:	reclaimer's gfp mask
+ * @mem:	cgroup memory controller handle, NULL for global reclaim
+ * @prio:	reclaimer's priority
+ *
+ * Called from reclaim at each priority level; once the priority drops to
+ * vmpressure_level_critical_prio, a full window of unproductive scanning
+ * is accounted, which evaluates the level at once and pushes it towards
+ * critical.
+ */
+void vmpressure_prio(gfp_t gfp, struct mem_cgroup *mem, int prio)
+{
+	if (prio > vmpressure_level_critical_prio)
+		return;
+
+	vmpressure(gfp, mem, vmpressure_win, 0);
+}
+
+/**
+ * vmpressure_register_event() - bind vmpressure notifications to an eventfd
+ * @cgrp:	cgroup that is interested in vmpressure notifications
+ * @cft:	cgroup control files handle
+ * @eventfd:	eventfd context to link notifications with
+ * @args:	event arguments (used to set up a pressure level threshold)
+ *
+ * Called through cgroup.event_control. @args is "low", "medium" or
+ * "critical"; the eventfd is signalled at that level and above.
+ */
+int vmpressure_register_event(struct cgroup *cgrp, struct cftype *cft,
+			      struct eventfd_ctx *eventfd, const char *args)
+{
+	struct vmpressure *vmpr = cg_to_vmpressure(cgrp);
+	struct vmpressure_event *ev;
+	int level;
+
+	for (level = 0; level < VMPRESSURE_NUM_LEVELS; level++) {
+		if (!strcmp(vmpressure_str_levels[level], args))
+			break;
+	}
+
+	if (level >= VMPRESSURE_NUM_LEVELS)
+		return -EINVAL;
+
+	ev = kzalloc(sizeof(*ev), GFP_KERNEL);
+	if (!ev)
+		return -ENOMEM;
+
+	ev->efd = eventfd;
+	ev->level = level;
+
+	mutex_lock(&vmpr->events_lock);
+	list_add(&ev->node, &vmpr->events);
+	mutex_unlock(&vmpr->events_lock);
+
+	return 0;
+}
+
+/**
+ * vmpressure_unregister_event() - unbind eventfd from vmpressure
+ * @cgrp:	cgroup handle
+ * @cft:	cgroup control files handle
+ * @eventfd:	eventfd context that was used to link vmpressure with the @cgrp
+ *
+ * Called when userspace closes the eventfd or the cgroup is removed.
+ */
+void vmpressure_unregister_event(struct cgroup *cgrp, struct cftype *cft,
+				 struct eventfd_ctx *eventfd)
+{
+	struct vmpressure *vmpr = cg_to_vmpressure(cgrp);
+	struct vmpressure_event *ev;
+
+	mutex_lock(&vmpr->events_lock);
+	list_for_each_entry(ev, &vmpr->events, node) {
+		if (ev->efd != eventfd)
+			continue;
+		list_del(&ev->node);
+		kfree(ev);
+		break;
+	}
+	mutex_unlock(&vmpr->events_lock);
+}
+
+/**
+ * vmpressure_init() - initialize vmpressure control structure
+ * @vmpr:	structure to be initialized
+ */
+void vmpressure_init(struct vmpressure *vmpr)
+{
+	spin_lock_init(&vmpr->sr_lock);
+	mutex_init(&vmpr->events_lock);
+	INIT_LIST_HEAD(&vmpr->events);
+	INIT_WORK(&vmpr->work, vmpressure_work_fn);
+}
+
+/**
+ * vmpressure_cleanup() - wait for a pending evaluation before teardown
+ * @vmpr:	structure to be cleaned up
+ */
+void vmpressure_cleanup(struct vmpressure *vmpr)
+{
+	flush_work(&vmpr->work);
+}
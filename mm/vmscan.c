@@ -43,6 +43,8 @@
 #include <linux/sysctl.h>
 #include <linux/oom.h>
 #include <linux/prefetch.h>
+#include <linux/ksm.h>
+#include <linux/vmpressure.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -108,6 +110,12 @@ struct scan_control {
 	/* Which cgroup do we reclaim from */
 	struct mem_cgroup *mem_cgroup;
 
+	/*
+	 * Reclaim pages even if they were referenced recently: the caller
+	 * knows better than the LRU that they are cold.
+	 */
+	int ignore_references;
+
 	/*
 	 * Nodemask of nodes allowed by the caller. If NULL, all nodes
 	 * are scanned.
@@ -498,9 +506,11 @@ static pageout_t pageout(struct page *page, struct address_space *mapping,
 
 /*
  * Same as remove_mapping, but if the page is removed from the mapping, it
- * gets returned with a refcount of 0.
+ * gets returned with a refcount of 0. @reclaimed tells that the page is
+ * evicted by reclaim, and so has to be remembered for workingset detection.
  */
-static int __remove_mapping(struct address_space *mapping, struct page *page)
+static int __remove_mapping(struct address_space *mapping, struct page *page,
+			    bool reclaimed)
 {
 	BUG_ON(!PageLocked(page));
 	BUG_ON(mapping != page_mapping(page));
@@ -550,6 +560,8 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 		freepage = mapping->a_ops->freepage;
 
 		__delete_from_page_cache(page);
+		if (reclaimed && page_is_file_cache(page))
+			workingset_eviction(mapping, page);
 		spin_unlock_irq(&mapping->tree_lock);
 		mem_cgroup_uncharge_cache_page(page);
 
@@ -572,7 +584,7 @@ cannot_free:
  */
 int remove_mapping(struct address_space *mapping, struct page *page)
 {
-	if (__remove_mapping(mapping, page)) {
+	if (__remove_mapping(mapping, page, false)) {
 		/*
 		 * Unfreezing the refcount with 1 rather than 2 effectively
 		 * drops the pagecache ref for us without requiring another
@@ -754,6 +766,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 		struct address_space *mapping;
 		struct page *page;
 		int may_enter_fs;
+		bool lazyfree = false;
 
 		cond_resched();
 
@@ -799,7 +812,10 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
-		references = page_check_references(page, sc);
+		if (sc->ignore_references)
+			references = PAGEREF_RECLAIM;
+		else
+			references = page_check_references(page, sc);
 		switch (references) {
 		case PAGEREF_ACTIVATE:
 			goto activate_locked;
@@ -813,12 +829,21 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 		/*
 		 * Anonymous process memory has backing store?
 		 * Try to allocate it some swap space here.
+		 *
+		 * Outside the swap cache, an anon page is only clean, in the
+		 * page and in a pte, when given up with MADV_FREE: whether it
+		 * was written to since shows in the ptes, which the unmap
+		 * below looks at anyway. add_to_swap() dirties the page for
+		 * the write out; leave that to the ptes instead.
 		 */
 		if (PageAnon(page) && !PageSwapCache(page)) {
 			if (!(sc->gfp_mask & __GFP_IO))
 				goto keep_locked;
+			lazyfree = !PageDirty(page) && !PageKsm(page);
 			if (!add_to_swap(page))
 				goto activate_locked;
+			if (lazyfree)
+				ClearPageDirty(page);
 			may_enter_fs = 1;
 		}
 
@@ -829,7 +854,22 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 		 * processes. Try to unmap it here.
 		 */
 		if (page_mapped(page) && mapping) {
-			switch (try_to_unmap(page, TTU_UNMAP)) {
+			enum ttu_flags ttu = TTU_UNMAP;
+			int ret;
+
+			if (sc->ignore_references)
+				ttu |= TTU_IGNORE_ACCESS;
+			if (lazyfree)
+				ttu |= TTU_LAZYFREE;
+			ret = try_to_unmap(page, ttu);
+			/*
+			 * The ptes still mapping the page were not looked at,
+			 * so nobody knows yet whether they were written to:
+			 * the page has to be written out before it is freed.
+			 */
+			if (lazyfree && ret != SWAP_SUCCESS)
+				SetPageDirty(page);
+			switch (ret) {
 			case SWAP_FAIL:
 				goto activate_locked;
 			case SWAP_AGAIN:
@@ -841,6 +881,10 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
+		/* Written to after all: swapped out as usual */
+		if (PageDirty(page))
+			lazyfree = false;
+
 		if (PageDirty(page)) {
 			nr_dirty++;
 
@@ -920,8 +964,10 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
-		if (!mapping || !__remove_mapping(mapping, page))
+		if (!mapping || !__remove_mapping(mapping, page, true))
 			goto keep_locked;
+		if (lazyfree)
+			count_vm_event(PGLAZYFREED);
 
 		/*
 		 * At this point, we have no other references and there is
@@ -981,6 +1027,65 @@ keep_lumpy:
 	return nr_reclaimed;
 }
 
+#ifdef CONFIG_PROCESS_RECLAIM
+/**
+ * reclaim_pages_from_list - reclaim pages chosen by the caller
+ * @page_list: pages taken off the LRU with isolate_lru_page()
+ *
+ * Used by per-process reclaim, which picks pages by owner rather than by
+ * LRU age. The pages are reclaimed regardless of their referenced state;
+ * anonymous pages go to swap. Pages that cannot be reclaimed are put back
+ * on the LRU, so @page_list is empty on return.
+ *
+ * Returns the number of pages reclaimed.
+ */
+unsigned long reclaim_pages_from_list(struct list_head *page_list)
+{
+	struct scan_control sc = {
+		.gfp_mask = GFP_KERNEL,
+		.may_writepage = !laptop_mode,
+		.may_unmap = 1,
+		.may_swap = 1,
+		.reclaim_mode = RECLAIM_MODE_SINGLE | RECLAIM_MODE_ASYNC,
+		.ignore_references = 1,
+	};
+	LIST_HEAD(zone_list);
+	unsigned long nr_reclaimed = 0;
+	struct page *page, *next;
+
+	/* shrink_page_list() works on one zone at a time */
+	while (!list_empty(page_list)) {
+		struct zone *zone = page_zone(lru_to_page(page_list));
+		unsigned long nr_anon = 0, nr_file = 0;
+
+		list_for_each_entry_safe(page, next, page_list, lru) {
+			if (page_zone(page) != zone)
+				continue;
+			ClearPageActive(page);
+			if (page_is_file_cache(page))
+				nr_file++;
+			else
+				nr_anon++;
+			list_move(&page->lru, &zone_list);
+		}
+		mod_zone_page_state(zone, NR_ISOLATED_ANON, nr_anon);
+		mod_zone_page_state(zone, NR_ISOLATED_FILE, nr_file);
+
+		nr_reclaimed += shrink_page_list(&zone_list, zone, &sc);
+
+		while (!list_empty(&zone_list)) {
+			page = lru_to_page(&zone_list);
+			list_del(&page->lru);
+			putback_lru_page(page);
+		}
+		mod_zone_page_state(zone, NR_ISOLATED_ANON, -nr_anon);
+		mod_zone_page_state(zone, NR_ISOLATED_FILE, -nr_file);
+	}
+
+	return nr_reclaimed;
+}
+#endif
+
 /*
  * Attempt to remove the specified page from its LRU.  Only take this page
  * if it is of the appropriate PageActive status.  Pages which are being
@@ -1989,6 +2094,9 @@ restart:
 	}
 	sc->nr_reclaimed += nr_reclaimed;
 
+	vmpressure(sc->gfp_mask, sc->mem_cgroup,
+		   sc->nr_scanned - nr_scanned, nr_reclaimed);
+
 	/*
 	 * Even if we did not try to evict anon pages at all, we want to
 	 * rebalance the anon lru active/inactive ratio.
@@ -2119,6 +2227,7 @@ static unsigned long do_try_to_free_pages(struct zonelist *zonelist,
 		count_vm_event(ALLOCSTALL);
 
 	for (priority = DEF_PRIORITY; priority >= 0; priority--) {
+		vmpressure_prio(sc->gfp_mask, sc->mem_cgroup, priority);
 		sc->nr_scanned = 0;
 		if (!priority)
 			disable_swap_token(sc->mem_cgroup);
@@ -2714,6 +2823,13 @@ static void kswapd_try_to_sleep(pg_data_t *pgdat, int order, int classzone_idx)
 		 * them before going back to sleep.
 		 */
 		set_pgdat_percpu_threshold(pgdat, calculate_normal_threshold);
+
+		/*
+		 * The node is balanced; hand over to kcompactd to get it ready
+		 * for high-order allocations if fragmentation calls for it.
+		 */
+		wakeup_kcompactd(pgdat, order, classzone_idx);
+
 		schedule();
 		set_pgdat_percpu_threshold(pgdat, calculate_pressure_threshold);
 	} else {
@@ -0,0 +1,307 @@
+/*
+ * mm/workingset.c - workingset detection
+ *
+ * Released under the GPL, see the file COPYING for details.
+ *
+ * The page cache LRU cannot tell a page that is being thrashed out of a
+ * working set that does not fit in the inactive list from a page that is
+ * read once while streaming: both are evicted from the inactive list
+ * without a second reference. To tell them apart, remember when each file
+ * page was evicted and look at it again when the page is read back.
+ *
+ * Each zone has a clock, inactive_age, that ticks on every eviction from
+ * and every activation out of its inactive file list. On eviction, a
+ * shadow entry holding the zone and the clock is left in the mapping's
+ * shadow_tree, at the index of the evicted page. When the page faults back
+ * in, the clock difference tells how many pages the inactive list had to
+ * make room for in between: the refault distance.
+ *
+ * Had the active list been that much smaller, the page would have stayed
+ * cached. So if the refault distance is no larger than the active file
+ * list, the page is part of a working set competing with the active pages
+ * and is activated on refault, to have a chance at pushing out active
+ * pages that are not used any more. A page read once never refaults, and
+ * a stream that is larger than memory refaults at distances the active
+ * list cannot match: neither displaces the working set.
+ *
+ * Shadow entries live until the page is read back in, its range is
+ * truncated or the inode is freed. They are kept in a tree of their own,
+ * as page cache lookups in this kernel expect nothing but pages in
+ * page_tree.
+ *
+ * An inode that stays cached would collect shadows for every page it
+ * ever had evicted. But a shadow only ever activates its page if the
+ * refault distance fits in the active list, so there is no point in
+ * keeping many more shadows than there are file pages on the LRU. A
+ * shrinker drops the excess, whole mappings at a time from the lowest
+ * index, so that the radix tree nodes actually get freed.
+ */
+
+#include <linux/mm.h>
+#include <linux/fs.h>
+#include <linux/swap.h>
+#include <linux/pagemap.h>
+#include <linux/pagevec.h>
+#include <linux/vmstat.h>
+#include <linux/init.h>
+
+/*
+ * Mappings that hold shadow entries, in the order they got their first
+ * one. Nests inside mapping->tree_lock, so it is taken with interrupts
+ * disabled.
+ */
+static DEFINE_SPINLOCK(shadow_lock);
+static LIST_HEAD(shadow_mappings);
+static atomic_long_t nr_shadows = ATOMIC_LONG_INIT(0);
+
+/*
+ * A shadow entry packs the eviction time, the node and the zone of the
+ * evicted page into one word. Bit 0 is reserved by the radix tree; bit 1
+ * is always set so that a shadow is never NULL.
+ */
+#define SHADOW_ENTRY		2UL
+#define SHADOW_ENTRY_SHIFT	2
+#define EVICTION_SHIFT		(SHADOW_ENTRY_SHIFT + NODES_SHIFT + ZONES_SHIFT)
+#define EVICTION_MASK		(~0UL >> EVICTION_SHIFT)
+
+static void *pack_shadow(unsigned long eviction, struct zone *zone)
+{
+	eviction = (eviction << NODES_SHIFT) | zone_to_nid(zone);
+	eviction = (eviction << ZONES_SHIFT) | zone_idx(zone);
+	eviction = (eviction << SHADOW_ENTRY_SHIFT) | SHADOW_ENTRY;
+
+	return (void *)eviction;
+}
+
+static void unpack_shadow(void *shadow, struct zone **zone,
+			  unsigned long *evictionp)
+{
+	unsigned long entry = (unsigned long)shadow;
+	int zid, nid;
+
+	entry >>= SHADOW_ENTRY_SHIFT;
+	zid = entry & ((1UL << ZONES_SHIFT) - 1);
+	entry >>= ZONES_SHIFT;
+	nid = entry & ((1UL << NODES_SHIFT) - 1);
+	entry >>= NODES_SHIFT;
+
+	*zone = NODE_DATA(nid)->node_zones + zid;
+	*evictionp = entry;
+}
+
+/**
+ * workingset_eviction - note the eviction of a page from the page cache
+ * @mapping: address space the page was evicted from
+ * @page: the page being evicted
+ *
+ * Called by reclaim with @mapping->tree_lock held, after @page left the
+ * page cache. Leaves a shadow entry at the page's index.
+ */
+void workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	unsigned long eviction;
+
+	eviction = atomic_long_inc_return(&zone->inactive_age);
+
+	/*
+	 * Only an inode's own mapping is guaranteed to be torn down through
+	 * end_writeback(), which drops what is left of the shadows.
+	 */
+	if (!mapping->host || mapping != &mapping->host->i_data)
+		return;
+
+	/* The tree allocates without blocking; losing a shadow is fine */
+	if (radix_tree_insert(&mapping->shadow_tree, page->index,
+			      pack_shadow(eviction, zone)))
+		return;
+
+	mapping->nrshadows++;
+	atomic_long_inc(&nr_shadows);
+	if (list_empty(&mapping->shadow_list)) {
+		spin_lock(&shadow_lock);
+		list_add_tail(&mapping->shadow_list, &shadow_mappings);
+		spin_unlock(&shadow_lock);
+	}
+}
+
+/**
+ * workingset_take_shadow - remove the shadow entry at an index
+ * @mapping: address space the page is being added to
+ * @index: page index
+ *
+ * Called with @mapping->tree_lock held. Returns the shadow entry, or
+ * %NULL if there was none.
+ */
+void *workingset_take_shadow(struct address_space *mapping, pgoff_t index)
+{
+	void *shadow;
+
+	shadow = radix_tree_delete(&mapping->shadow_tree, index);
+	if (shadow) {
+		mapping->nrshadows--;
+		atomic_long_dec(&nr_shadows);
+	}
+	return shadow;
+}
+
+/**
+ * workingset_refault - evaluate the refault of a previously evicted page
+ * @shadow: shadow entry of the evicted page
+ *
+ * Calculates the refault distance of the page, counted in inactive list
+ * evictions and activations since the page was evicted.
+ *
+ * Returns %true if the page should be activated, %false otherwise.
+ */
+bool workingset_refault(void *shadow)
+{
+	unsigned long refault_distance;
+	unsigned long eviction;
+	unsigned long refault;
+	struct zone *zone;
+
+	unpack_shadow(shadow, &zone, &eviction);
+
+	refault = atomic_long_read(&zone->inactive_age);
+	refault_distance = (refault - eviction) & EVICTION_MASK;
+
+	inc_zone_state(zone, WORKINGSET_REFAULT);
+
+	if (refault_distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+		inc_zone_state(zone, WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}
+
+/**
+ * workingset_forget_range - drop shadow entries
+ * @mapping: address space to drop the shadows from
+ * @start: first page index
+ * @end: last page index, inclusive
+ *
+ * Called when the pages in a range of a mapping go away for good, on
+ * truncation and inode teardown, after the pages themselves were removed.
+ */
+void workingset_forget_range(struct address_space *mapping,
+			     pgoff_t start, pgoff_t end)
+{
+	unsigned long indices[PAGEVEC_SIZE];
+	void **slots[PAGEVEC_SIZE];
+	unsigned int i, nr;
+
+	while (mapping->nrshadows && start <= end) {
+		spin_lock_irq(&mapping->tree_lock);
+		nr = radix_tree_gang_lookup_slot(&mapping->shadow_tree, slots,
+						 indices, start, PAGEVEC_SIZE);
+		for (i = 0; i < nr && indices[i] <= end; i++)
+			workingset_take_shadow(mapping, indices[i]);
+		spin_unlock_irq(&mapping->tree_lock);
+
+		if (i < nr || nr < PAGEVEC_SIZE)
+			break;
+		start = indices[nr - 1] + 1;
+		if (!start)
+			break;		/* wrapped */
+		cond_resched();
+	}
+
+	/*
+	 * Unlink a mapping without shadows: the inode may be about to be
+	 * freed. Only eviction links it, which cannot race with teardown.
+	 */
+	if (!list_empty(&mapping->shadow_list)) {
+		spin_lock_irq(&mapping->tree_lock);
+		if (!mapping->nrshadows) {
+			spin_lock(&shadow_lock);
+			list_del_init(&mapping->shadow_list);
+			spin_unlock(&shadow_lock);
+		}
+		spin_unlock_irq(&mapping->tree_lock);
+	}
+}
+
+/*
+ * Drop up to @nr shadow entries of @mapping, from the lowest index.
+ * Called with shadow_lock and @mapping->tree_lock held.
+ */
+static unsigned long drop_shadows(struct address_space *mapping,
+				  unsigned long nr)
+{
+	unsigned long indices[PAGEVEC_SIZE];
+	void **slots[PAGEVEC_SIZE];
+	unsigned long dropped = 0;
+	unsigned int i, n;
+
+	while (dropped < nr && mapping->nrshadows) {
+		n = radix_tree_gang_lookup_slot(&mapping->shadow_tree, slots,
+				indices, 0,
+				min_t(unsigned long, nr - dropped, PAGEVEC_SIZE));
+		if (!n)
+			break;
+		for (i = 0; i < n; i++)
+			workingset_take_shadow(mapping, indices[i]);
+		dropped += n;
+	}
+	return dropped;
+}
+
+static long excess_shadows(void)
+{
+	return atomic_long_read(&nr_shadows) -
+		(long)(global_page_state(NR_ACTIVE_FILE) +
+		       global_page_state(NR_INACTIVE_FILE));
+}
+
+static int shrink_shadows(struct shrinker *shrink, struct shrink_control *sc)
+{
+	unsigned long nr = sc->nr_to_scan;
+	struct address_space *mapping;
+	long excess;
+
+	if (!nr)
+		goto out;
+
+	spin_lock_irq(&shadow_lock);
+	while (nr && excess_shadows() > 0 && !list_empty(&shadow_mappings)) {
+		mapping = list_first_entry(&shadow_mappings,
+					   struct address_space, shadow_list);
+		list_move_tail(&mapping->shadow_list, &shadow_mappings);
+
+		/* The lock order is the other way round; skip busy ones */
+		if (!spin_trylock(&mapping->tree_lock)) {
+			nr--;
+			continue;
+		}
+		nr -= drop_shadows(mapping, nr);
+		if (!mapping->nrshadows)
+			list_del_init(&mapping->shadow_list);
+		spin_unlock(&mapping->tree_lock);
+	}
+	spin_unlock_irq(&shadow_lock);
+out:
+	excess = excess_shadows();
+	return excess > 0 ? min_t(long, excess, INT_MAX) : 0;
+}
+
+static struct shrinker shadow_shrinker = {
+	.shrink = shrink_shadows,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static int __init workingset_init(void)
+{
+	register_shrinker(&shadow_shrinker);
+	return 0;
+}
+module_init(workingset_init);